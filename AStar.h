@@ -0,0 +1,166 @@
+#pragma once
+
+#include <vector>
+#include <cmath>
+#include <cstdint>
+#include <utility>
+#include <algorithm>
+#include <stdexcept>
+#include <type_traits>
+#include "DaryHeap.h"
+
+
+/*!
+ * \brief Евклидово расстояние между значениями вершин (любой тип с полями x, y, z, например Point)
+ *
+ * Допустимая эвристика, если вес каждого ребра не меньше расстояния между его концами.
+ */
+struct euclidean_heuristic {
+    template<typename point_t>
+    double operator()(const point_t& from, const point_t& to) const {
+        double dx = from.x - to.x, dy = from.y - to.y, dz = from.z - to.z;
+        return std::sqrt(dx * dx + dy * dy + dz * dz);
+    }
+};
+
+/*!
+ * \brief Поиск A* над CSR-снимком графа
+ *
+ * Вершины извлекаются по g + inflation * h, где h = heuristic(value(v), value(target)).
+ * При inflation == 1 и допустимой эвристике путь кратчайший (закрытые вершины при
+ * улучшении открываются заново); при inflation > 1 - взвешенный A*: переоткрытий нет,
+ * а длина пути не больше inflation * оптимум.
+ * @tparam csr_t CsrGraph или совместимое представление
+ * @tparam heuristic_t
+ */
+template<typename csr_t, typename heuristic_t = euclidean_heuristic>
+class AStarEngine {
+public:
+    typedef typename csr_t::id_type id_type;
+    typedef std::decay_t<decltype(std::declval<const csr_t&>().weight(0))> weight_type;
+
+    static constexpr id_type npos = csr_t::npos;
+
+private:
+    const csr_t* graph_;
+    heuristic_t heuristic_;
+    double inflation_;
+
+    std::vector<weight_type> dist_;
+    std::vector<id_type> parent_;
+    std::vector<std::uint32_t> stamp_;
+    std::uint32_t current_ = 0;
+    DaryHeap<weight_type> heap_;
+    std::size_t settled_ = 0;
+
+    void next_generation() {
+        if (dist_.size() != graph_->size()) {
+            dist_.assign(graph_->size(), weight_type());
+            parent_.assign(graph_->size(), npos);
+            stamp_.assign(graph_->size(), 0);
+            heap_.resize(graph_->size());
+            current_ = 0;
+        }
+
+        heap_.clear();
+        settled_ = 0;
+
+        if (++current_ == 0) {
+            std::fill(stamp_.begin(), stamp_.end(), 0);
+            current_ = 1;
+        }
+    }
+
+    weight_type priority(id_type id, id_type target, weight_type g) const {
+        return g + static_cast<weight_type>(inflation_ * heuristic_(graph_->value(id), graph_->value(target)));
+    }
+
+public:
+    explicit AStarEngine(const csr_t& graph, heuristic_t heuristic = heuristic_t(), double inflation = 1.0)
+            : graph_(&graph), heuristic_(heuristic), inflation_(inflation) {
+        if (inflation < 1.0) {
+            throw std::logic_error("inflation must be at least 1.\n");
+        }
+    }
+
+    /*!
+     * \brief Поиск пути source -> target
+     * @return true, если путь есть
+     */
+    bool run(id_type source, id_type target) {
+        next_generation();
+
+        stamp_[source] = current_;
+        dist_[source] = weight_type();
+        parent_[source] = npos;
+        heap_.push(source, priority(source, target, weight_type()));
+
+        bool reopen = inflation_ == 1.0;
+
+        while (!heap_.empty()) {
+            id_type v = heap_.pop();
+            settled_++;
+            if (v == target) {
+                return true;
+            }
+
+            weight_type dv = dist_[v];
+            for (std::size_t e = graph_->edge_begin(v), end = graph_->edge_end(v); e < end; e++) {
+                const weight_type& len = graph_->weight(e);
+                if (len < 0) {
+                    throw std::logic_error("negative weight.\n");
+                }
+
+                id_type to = graph_->target(e);
+                weight_type candidate = dv + len;
+
+                if (stamp_[to] != current_) {
+                    stamp_[to] = current_;
+                } else if (!(candidate < dist_[to]) || (!reopen && !heap_.contains(to))) {
+                    continue;
+                }
+
+                dist_[to] = candidate;
+                parent_[to] = v;
+                heap_.push_or_decrease(to, priority(to, target, candidate));
+            }
+        }
+
+        return false;
+    }
+
+    const weight_type& distance(id_type id) const {
+        return dist_[id];
+    }
+
+    /*!
+     * \brief Сколько вершин извлечено из кучи последним поиском
+     */
+    std::size_t settled() const {
+        return settled_;
+    }
+
+    template<typename route_t>
+    route_t route(id_type target) const {
+        route_t result;
+
+        for (id_type v = target; v != npos; v = parent_[v]) {
+            result.push_back(graph_->key(v));
+        }
+
+        std::reverse(result.begin(), result.end());
+        return result;
+    }
+
+    template<typename route_t, typename node_type_t>
+    std::pair<weight_type, route_t> query(const node_type_t& key_from, const node_type_t& key_to) {
+        id_type from = graph_->at(key_from);
+        id_type to = graph_->at(key_to);
+
+        if (!run(from, to)) {
+            throw std::logic_error("no route.\n");
+        }
+
+        return std::pair<weight_type, route_t>(dist_[to], route<route_t>(to));
+    }
+};
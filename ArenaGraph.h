@@ -0,0 +1,101 @@
+#pragma once
+
+#include <cstddef>
+#include <memory_resource>
+#include <type_traits>
+#include "Graph.h"
+
+
+/*!
+ * \brief Граф, вся память которого выделяется из монотонной арены и освобождается разом
+ *
+ * Вершины, рёбра и обратный индекс берутся сдвигом указателя в блоках арены;
+ * удаление отдельных вершин и рёбер память не возвращает. release() (и
+ * деструктор) отдаёт все блоки сразу. Если ключи, значения и веса тривиально
+ * разрушаемы, узлы даже не обходятся: таблица вершин просто забывается.
+ * Граф, полученный через graph(), нельзя перемещать за пределы ArenaGraph -
+ * его память принадлежит арене; копия же берёт память у ресурса по умолчанию.
+ * Арена однопоточная (monotonic_buffer_resource без синхронизации): изменять
+ * граф можно только из одного потока за раз. Параллельные загрузчики
+ * (bulk_insert, load_edge_list) для pmr-хранения сами вставляют рёбра в один поток.
+ * @tparam key_type
+ * @tparam value_type
+ * @tparam weight_type
+ * @tparam storage_type pmr-политика хранения (см. Storage.h)
+ */
+template<typename key_type, typename value_type, typename weight_type, typename storage_type = pmr_storage>
+class ArenaGraph {
+public:
+    typedef Graph<key_type, value_type, weight_type, storage_type> graph_type;
+
+private:
+    typedef decltype(graph_type::graph) table_type;
+
+    static_assert(std::uses_allocator<table_type, std::pmr::polymorphic_allocator<std::byte>>::value &&
+                  std::uses_allocator<typename storage_type::template edge_table<key_type, weight_type>,
+                          std::pmr::polymorphic_allocator<std::byte>>::value,
+                  "arena graph needs pmr storage");
+
+    static constexpr bool trivial = std::is_trivially_destructible<key_type>::value &&
+                                    std::is_trivially_destructible<value_type>::value &&
+                                    std::is_trivially_destructible<weight_type>::value;
+
+    std::pmr::monotonic_buffer_resource arena_;
+    graph_type graph_;
+
+public:
+    /*!
+     * \param initial_size размер первого блока арены, байт
+     * \param upstream откуда арена берёт блоки
+     */
+    explicit ArenaGraph(std::size_t initial_size = 1 << 20,
+                        std::pmr::memory_resource* upstream = std::pmr::get_default_resource())
+            : arena_(initial_size, upstream), graph_(&arena_) {}
+
+    /*!
+     * \brief Копия graph в арене
+     */
+    explicit ArenaGraph(const graph_type& graph, std::size_t initial_size = 1 << 20,
+                        std::pmr::memory_resource* upstream = std::pmr::get_default_resource())
+            : arena_(initial_size, upstream), graph_(graph, &arena_) {}
+
+    ArenaGraph(const ArenaGraph& other) = delete;
+
+    ArenaGraph& operator=(const ArenaGraph& rhs) = delete;
+
+    ~ArenaGraph() {
+        release();
+    }
+
+    graph_type& graph() {
+        return graph_;
+    }
+
+    const graph_type& graph() const {
+        return graph_;
+    }
+
+    std::pmr::memory_resource* resource() {
+        return &arena_;
+    }
+
+    /*!
+     * \brief Удалить все вершины и вернуть всю память арены её источнику
+     *
+     * Граф остаётся пригодным: новые вершины снова выделяются из арены.
+     * Подписчики получают graph_change::reset.
+     */
+    void release() {
+        graph_.generation_++;
+
+        if constexpr (trivial) {
+            // узлы не разрушаются: ничего, кроме памяти арены, они не держат
+            ::new (static_cast<void*>(&graph_.graph)) table_type(typename table_type::allocator_type(&arena_));
+        } else {
+            graph_.graph.clear();
+        }
+
+        arena_.release();
+        graph_.notify(graph_change::reset, key_type());
+    }
+};
@@ -0,0 +1,86 @@
+#pragma once
+
+#include <vector>
+#include <memory>
+#include <utility>
+#include "Parallel.h"
+#include "Dijkstra.h"
+
+
+/*!
+ * \brief Результат одного запроса пакета: при status != ok расстояние и маршрут пусты
+ */
+template<typename weight_type, typename route_t>
+struct PathResult {
+    query_status status = query_status::ok;
+    weight_type distance = weight_type();
+    route_t route;
+};
+
+/*!
+ * \brief Пакетное выполнение запросов "точка-точка" Дейкстрой на пуле потоков
+ *
+ * У каждого потока пула свой DijkstraEngine, так что состояние поиска
+ * переиспользуется между запросами без синхронизации. Ошибки запросов
+ * возвращаются статусом, а не исключением, и не мешают остальным.
+ * @tparam csr_t CsrGraph или совместимое представление
+ */
+template<typename csr_t>
+class DijkstraBatch {
+public:
+    typedef typename csr_t::id_type id_type;
+    typedef typename DijkstraEngine<csr_t>::weight_type weight_type;
+
+    static constexpr id_type npos = csr_t::npos;
+
+private:
+    const csr_t* graph_;
+    ThreadPool pool_;
+    std::vector<std::unique_ptr<DijkstraEngine<csr_t>>> engines_;
+
+public:
+    /*!
+     * \param threads число потоков, 0 - по числу ядер
+     */
+    explicit DijkstraBatch(const csr_t& graph, unsigned threads = 0) : graph_(&graph), pool_(threads) {
+        for (unsigned worker = 0; worker < pool_.size(); worker++) {
+            engines_.emplace_back(new DijkstraEngine<csr_t>(graph));
+        }
+    }
+
+    const csr_t& graph() const {
+        return *graph_;
+    }
+
+    unsigned threads() const {
+        return pool_.size();
+    }
+
+    /*!
+     * \brief Ответы на запросы (key_from, key_to) в том же порядке
+     */
+    template<typename route_t, typename node_type_t>
+    std::vector<PathResult<weight_type, route_t>> run(const std::vector<std::pair<node_type_t, node_type_t>>& queries) {
+        std::vector<PathResult<weight_type, route_t>> results(queries.size());
+
+        pool_.run(queries.size(), [&](unsigned worker, std::size_t index) {
+            PathResult<weight_type, route_t>& result = results[index];
+            id_type from = graph_->id(queries[index].first);
+            id_type to = graph_->id(queries[index].second);
+
+            if (from == npos || to == npos) {
+                result.status = query_status::no_node;
+                return;
+            }
+
+            DijkstraEngine<csr_t>& engine = *engines_[worker];
+            result.status = engine.try_run(from, to);
+            if (result.status == query_status::ok) {
+                result.distance = engine.distance(to);
+                result.route = engine.template route<route_t>(to);
+            }
+        });
+
+        return results;
+    }
+};
@@ -0,0 +1,244 @@
+#pragma once
+
+#include <deque>
+#include <vector>
+#include <cstdint>
+#include <utility>
+#include <algorithm>
+#include <stdexcept>
+#include <type_traits>
+#include "Dijkstra.h"
+#include "ShortestPathTree.h"
+
+
+/*!
+ * \brief Кратчайшие пути при отрицательных весах: Беллман - Форд с очередью (SPFA)
+ *
+ * В очереди только вершины, расстояние до которых изменилось, поэтому без
+ * отрицательных циклов поиск обычно заканчивается намного раньше V проходов.
+ * Метка длины пути (в рёбрах) доходит до V только при достижимом отрицательном
+ * цикле; тогда цикл ищется в графе предков (проверка не чаще раза на V
+ * релаксаций) и доступен через negative_cycle().
+ * @tparam csr_t CsrGraph или совместимое представление
+ */
+template<typename csr_t>
+class BellmanFordEngine {
+public:
+    typedef typename csr_t::id_type id_type;
+    typedef std::decay_t<decltype(std::declval<const csr_t&>().weight(0))> weight_type;
+
+    static constexpr id_type npos = csr_t::npos;
+
+private:
+    const csr_t* graph_;
+    std::vector<weight_type> dist_;
+    std::vector<id_type> parent_;
+    std::vector<id_type> length_;
+    std::vector<std::uint8_t> reached_;
+    std::vector<std::uint8_t> queued_;
+    std::vector<id_type> cycle_;
+    id_type source_ = npos;
+
+    // цикл в графе предков, если он есть: каждая вершина проходится один раз
+    bool find_cycle() {
+        std::vector<id_type> walk(graph_->size(), npos);
+
+        for (id_type start = 0; start < graph_->size(); start++) {
+            id_type v = start;
+            while (v != npos && walk[v] == npos) {
+                walk[v] = start;
+                v = parent_[v];
+            }
+
+            if (v == npos || walk[v] != start) {
+                continue;
+            }
+
+            cycle_.clear();
+            id_type u = v;
+            do {
+                cycle_.push_back(u);
+                u = parent_[u];
+            } while (u != v);
+
+            std::reverse(cycle_.begin(), cycle_.end());
+            return true;
+        }
+
+        return false;
+    }
+
+    query_status relax(std::deque<id_type>& queue) {
+        std::size_t n = graph_->size();
+        std::size_t since_check = n;
+
+        while (!queue.empty()) {
+            id_type v = queue.front();
+            queue.pop_front();
+            queued_[v] = 0;
+
+            weight_type dv = dist_[v];
+            for (std::size_t e = graph_->edge_begin(v), end = graph_->edge_end(v); e < end; e++) {
+                id_type to = graph_->target(e);
+                weight_type candidate = dv + graph_->weight(e);
+
+                if (reached_[to] && !(candidate < dist_[to])) {
+                    continue;
+                }
+
+                reached_[to] = 1;
+                dist_[to] = candidate;
+                parent_[to] = v;
+                length_[to] = length_[v] + 1;
+
+                if (length_[to] >= n && ++since_check >= n) {
+                    since_check = 0;
+                    if (find_cycle()) {
+                        return query_status::negative_cycle;
+                    }
+                }
+
+                if (!queued_[to]) {
+                    queued_[to] = 1;
+                    queue.push_back(to);
+                }
+            }
+        }
+
+        return query_status::ok;
+    }
+
+    void reset() {
+        std::size_t n = graph_->size();
+        dist_.assign(n, weight_type());
+        parent_.assign(n, npos);
+        length_.assign(n, 0);
+        reached_.assign(n, 0);
+        queued_.assign(n, 0);
+        cycle_.clear();
+    }
+
+public:
+    explicit BellmanFordEngine(const csr_t& graph) : graph_(&graph) {}
+
+    const csr_t& graph() const {
+        return *graph_;
+    }
+
+    /*!
+     * \brief Поиск из source; при достижимом отрицательном цикле - исключение "negative cycle."
+     */
+    void run(id_type source) {
+        if (try_run(source) == query_status::negative_cycle) {
+            throw std::logic_error("negative cycle.\n");
+        }
+    }
+
+    /*!
+     * \brief То же, что run(), но отрицательный цикл возвращается статусом
+     */
+    query_status try_run(id_type source) {
+        reset();
+
+        source_ = source;
+        reached_[source] = 1;
+        queued_[source] = 1;
+
+        std::deque<id_type> queue(1, source);
+        return relax(queue);
+    }
+
+    /*!
+     * \brief Поиск от всех вершин сразу (как от добавленного источника с рёбрами веса 0 во все):
+     * distance() - потенциалы для алгоритма Джонсона. Находит любой отрицательный цикл графа.
+     */
+    query_status try_run_all() {
+        reset();
+
+        source_ = npos;
+        std::deque<id_type> queue;
+        for (id_type v = 0; v < graph_->size(); v++) {
+            reached_[v] = 1;
+            queued_[v] = 1;
+            queue.push_back(v);
+        }
+
+        return relax(queue);
+    }
+
+    bool reached(id_type id) const {
+        return reached_[id] != 0;
+    }
+
+    const weight_type& distance(id_type id) const {
+        return dist_[id];
+    }
+
+    id_type parent(id_type id) const {
+        return parent_[id];
+    }
+
+    /*!
+     * \brief Отрицательный цикл, найденный последним поиском (ключи по порядку рёбер), или пустой маршрут
+     */
+    template<typename route_t>
+    route_t negative_cycle() const {
+        route_t result;
+        for (id_type v : cycle_) {
+            result.push_back(graph_->key(v));
+        }
+
+        return result;
+    }
+
+    template<typename route_t>
+    route_t route(id_type target) const {
+        route_t result;
+
+        for (id_type v = target; v != npos; v = parent_[v]) {
+            result.push_back(graph_->key(v));
+        }
+
+        std::reverse(result.begin(), result.end());
+        return result;
+    }
+
+    /*!
+     * \brief Кратчайший путь между ключами, как у dijkstra(), но с отрицательными весами
+     */
+    template<typename route_t, typename node_type_t>
+    std::pair<weight_type, route_t> query(const node_type_t& key_from, const node_type_t& key_to) {
+        id_type from = graph_->at(key_from);
+        id_type to = graph_->at(key_to);
+
+        run(from);
+        if (!reached(to)) {
+            throw std::logic_error("no route.\n");
+        }
+
+        return std::pair<weight_type, route_t>(dist_[to], route<route_t>(to));
+    }
+
+    /*!
+     * \brief Дерево кратчайших путей последнего поиска из одной вершины
+     */
+    ShortestPathTree<csr_t> tree() const {
+        std::vector<weight_type> dist(graph_->size(), weight_type());
+        std::vector<id_type> parent(graph_->size(), npos);
+
+        for (id_type v = 0; v < graph_->size(); v++) {
+            if (reached_[v]) {
+                dist[v] = dist_[v];
+                parent[v] = parent_[v];
+            }
+        }
+
+        return ShortestPathTree<csr_t>(*graph_, source_, std::move(dist), std::move(parent));
+    }
+
+    template<typename node_type_t>
+    ShortestPathTree<csr_t> tree(const node_type_t& key_from) {
+        run(graph_->at(key_from));
+        return tree();
+    }
+};
@@ -0,0 +1,314 @@
+#pragma once
+
+#include <vector>
+#include <atomic>
+#include <memory>
+#include <limits>
+#include <cstdint>
+#include <utility>
+#include <algorithm>
+#include <stdexcept>
+#include "Parallel.h"
+#include "ShortestPathTree.h"
+
+
+/*!
+ * \brief Параллельный BFS с переключением направления (Beamer): число рёбер и предки от источника
+ *
+ * Пока фронт мал, уровень строится сверху вниз: фронт - список, соседи
+ * захватываются атомарным битом в битовой карте посещённых. Когда рёбер из
+ * фронта становится больше, чем 1/alpha рёбер непосещённых вершин, поиск идёт
+ * снизу вверх: каждая непосещённая вершина ищет родителя среди входящих рёбер
+ * (граф backward, обычно forward.transpose()) в битовой карте фронта. Обратно
+ * сверху вниз - когда фронт меньше 1/beta всех вершин.
+ * @tparam csr_t CsrGraph или совместимое представление
+ */
+template<typename csr_t>
+class BfsEngine {
+public:
+    typedef typename csr_t::id_type id_type;
+    typedef std::uint32_t hops_type;
+
+    static constexpr id_type npos = csr_t::npos;
+
+    static constexpr std::size_t alpha = 14;
+    static constexpr std::size_t beta = 24;
+
+private:
+    static constexpr hops_type unreached = std::numeric_limits<hops_type>::max();
+
+    const csr_t* forward_;
+    const csr_t* backward_;
+    unsigned threads_;
+
+    std::vector<hops_type> level_;
+    std::vector<id_type> parent_;
+    std::size_t words_;
+    std::unique_ptr<std::atomic<std::uint64_t>[]> visited_;
+    std::vector<std::uint64_t> frontier_bits_;
+    std::vector<std::uint64_t> next_bits_;
+    std::vector<id_type> frontier_;
+    std::vector<std::vector<id_type>> found_;
+    std::vector<std::size_t> counts_;
+    std::vector<std::size_t> edges_;
+
+    id_type source_ = npos;
+    std::size_t bottom_up_steps_ = 0;
+
+    std::size_t degree(id_type id) const {
+        return forward_->edge_end(id) - forward_->edge_begin(id);
+    }
+
+    // возвращает число рёбер из нового фронта
+    std::size_t step_top_down(hops_type depth) {
+        unsigned parts = worker_count(threads_, frontier_.size(), 256);
+
+        parallel_for(0, frontier_.size(), parts, [&](unsigned part, std::size_t lo, std::size_t hi) {
+            std::vector<id_type>& found = found_[part];
+            std::size_t edges = 0;
+
+            for (std::size_t i = lo; i < hi; i++) {
+                id_type v = frontier_[i];
+
+                for (std::size_t e = forward_->edge_begin(v), end = forward_->edge_end(v); e < end; e++) {
+                    id_type to = forward_->target(e);
+                    std::atomic<std::uint64_t>& word = visited_[to / 64];
+                    std::uint64_t mask = std::uint64_t(1) << (to % 64);
+
+                    if ((word.load(std::memory_order_relaxed) & mask) ||
+                        (word.fetch_or(mask, std::memory_order_relaxed) & mask)) {
+                        continue;
+                    }
+
+                    level_[to] = depth;
+                    parent_[to] = v;
+                    found.push_back(to);
+                    edges += degree(to);
+                }
+            }
+
+            edges_[part] = edges;
+        });
+
+        frontier_.clear();
+        std::size_t edges = 0;
+        for (unsigned part = 0; part < parts; part++) {
+            frontier_.insert(frontier_.end(), found_[part].begin(), found_[part].end());
+            found_[part].clear();
+            edges += edges_[part];
+        }
+
+        return edges;
+    }
+
+    // фронт - frontier_bits_, новый фронт остаётся там же, его размер - в counts_
+    std::size_t step_bottom_up(hops_type depth) {
+        unsigned parts = worker_count(threads_, words_, 64);
+        std::fill(next_bits_.begin(), next_bits_.end(), 0);
+
+        // куски выровнены по словам, поэтому каждое слово карт пишет один поток
+        parallel_for(0, words_, parts, [&](unsigned part, std::size_t lo, std::size_t hi) {
+            std::size_t count = 0, edges = 0;
+
+            for (std::size_t w = lo; w < hi; w++) {
+                std::uint64_t seen = visited_[w].load(std::memory_order_relaxed);
+                if (~seen == 0) {
+                    continue;
+                }
+
+                for (unsigned bit = 0; bit < 64; bit++) {
+                    if (seen >> bit & 1) {
+                        continue;
+                    }
+
+                    id_type v = static_cast<id_type>(w * 64 + bit);
+                    for (std::size_t e = backward_->edge_begin(v), end = backward_->edge_end(v); e < end; e++) {
+                        id_type from = backward_->target(e);
+                        if (frontier_bits_[from / 64] >> (from % 64) & 1) {
+                            level_[v] = depth;
+                            parent_[v] = from;
+                            next_bits_[w] |= std::uint64_t(1) << bit;
+                            count++;
+                            edges += degree(v);
+                            break;
+                        }
+                    }
+                }
+
+                visited_[w].store(seen | next_bits_[w], std::memory_order_relaxed);
+            }
+
+            counts_[part] = count;
+            edges_[part] = edges;
+        });
+
+        frontier_bits_.swap(next_bits_);
+
+        std::size_t count = 0, edges = 0;
+        for (unsigned part = 0; part < parts; part++) {
+            count += counts_[part];
+            edges += edges_[part];
+        }
+        counts_[0] = count;
+
+        return edges;
+    }
+
+    void list_to_bits() {
+        std::fill(frontier_bits_.begin(), frontier_bits_.end(), 0);
+        for (id_type v : frontier_) {
+            frontier_bits_[v / 64] |= std::uint64_t(1) << (v % 64);
+        }
+    }
+
+    void bits_to_list() {
+        frontier_.clear();
+        for (std::size_t w = 0; w < words_; w++) {
+            for (unsigned bit = 0; bit < 64; bit++) {
+                if (frontier_bits_[w] >> bit & 1) {
+                    frontier_.push_back(static_cast<id_type>(w * 64 + bit));
+                }
+            }
+        }
+    }
+
+public:
+    /*!
+     * \param backward граф с обращёнными рёбрами и теми же id, что у forward
+     * \param threads число потоков, 0 - по числу ядер
+     */
+    BfsEngine(const csr_t& forward, const csr_t& backward, unsigned threads = 0)
+            : forward_(&forward), backward_(&backward), threads_(worker_count(threads, forward.size(), 1)),
+              level_(forward.size(), unreached), parent_(forward.size(), npos), words_((forward.size() + 63) / 64),
+              visited_(new std::atomic<std::uint64_t>[words_]), frontier_bits_(words_), next_bits_(words_),
+              found_(threads_), counts_(threads_), edges_(threads_) {
+        if (backward.size() != forward.size()) {
+            throw std::logic_error("backward graph does not match forward graph.\n");
+        }
+    }
+
+    BfsEngine(const BfsEngine& other) = delete;
+
+    BfsEngine& operator=(const BfsEngine& rhs) = delete;
+
+    const csr_t& graph() const {
+        return *forward_;
+    }
+
+    /*!
+     * \brief Обход в ширину из source по всем достижимым вершинам
+     */
+    void run(id_type source) {
+        std::size_t n = forward_->size();
+
+        parallel_for(0, n, worker_count(threads_, n), [&](unsigned, std::size_t lo, std::size_t hi) {
+            std::fill(level_.begin() + lo, level_.begin() + hi, unreached);
+            std::fill(parent_.begin() + lo, parent_.begin() + hi, npos);
+        });
+
+        for (std::size_t w = 0; w < words_; w++) {
+            visited_[w].store(0, std::memory_order_relaxed);
+        }
+
+        // биты за последней вершиной считаются посещёнными, чтобы снизу вверх их не проверять
+        if (n % 64 != 0) {
+            visited_[words_ - 1].store(~std::uint64_t(0) << (n % 64), std::memory_order_relaxed);
+        }
+
+        source_ = source;
+        bottom_up_steps_ = 0;
+        level_[source] = 0;
+        visited_[source / 64].fetch_or(std::uint64_t(1) << (source % 64), std::memory_order_relaxed);
+
+        frontier_.assign(1, source);
+        std::size_t count = 1;
+        std::size_t frontier_edges = degree(source);
+        std::size_t unexplored = forward_->edge_count() - frontier_edges;
+        bool bottom_up = false;
+
+        for (hops_type depth = 1; count > 0; depth++) {
+            if (!bottom_up && frontier_edges > unexplored / alpha) {
+                bottom_up = true;
+                list_to_bits();
+            } else if (bottom_up && count < n / beta) {
+                bottom_up = false;
+                bits_to_list();
+            }
+
+            if (bottom_up) {
+                frontier_edges = step_bottom_up(depth);
+                count = counts_[0];
+                bottom_up_steps_++;
+            } else {
+                frontier_edges = step_top_down(depth);
+                count = frontier_.size();
+            }
+
+            unexplored -= frontier_edges;
+        }
+    }
+
+    bool reached(id_type id) const {
+        return level_[id] != unreached;
+    }
+
+    /*!
+     * \brief Число рёбер в кратчайшем по рёбрам пути от источника
+     */
+    hops_type level(id_type id) const {
+        return level_[id];
+    }
+
+    id_type parent(id_type id) const {
+        return parent_[id];
+    }
+
+    /*!
+     * \brief Сколько уровней последнего run() построено снизу вверх
+     */
+    std::size_t bottom_up_steps() const {
+        return bottom_up_steps_;
+    }
+
+    template<typename route_t>
+    route_t route(id_type target) const {
+        route_t result;
+
+        for (id_type v = target; v != npos; v = parent_[v]) {
+            result.push_back(forward_->key(v));
+        }
+
+        std::reverse(result.begin(), result.end());
+        return result;
+    }
+
+    /*!
+     * \brief Дерево обхода последнего run(): расстояние - число рёбер
+     */
+    ShortestPathTree<csr_t, hops_type> tree() const {
+        std::vector<hops_type> level(level_.size(), 0);
+        for (std::size_t v = 0; v < level_.size(); v++) {
+            if (level_[v] != unreached) {
+                level[v] = level_[v];
+            }
+        }
+
+        return ShortestPathTree<csr_t, hops_type>(*forward_, source_, std::move(level), parent_);
+    }
+
+    /*!
+     * \brief Путь с наименьшим числом рёбер между ключами: пара (число рёбер, маршрут)
+     */
+    template<typename route_t, typename node_type_t>
+    std::pair<hops_type, route_t> query(const node_type_t& key_from, const node_type_t& key_to) {
+        id_type from = forward_->at(key_from);
+        id_type to = forward_->at(key_to);
+
+        run(from);
+        if (!reached(to)) {
+            throw std::logic_error("no route.\n");
+        }
+
+        return std::pair<hops_type, route_t>(level_[to], route<route_t>(to));
+    }
+};
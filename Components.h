@@ -0,0 +1,485 @@
+#pragma once
+
+#include <atomic>
+#include <vector>
+#include <memory>
+#include <cstdint>
+#include <utility>
+#include <algorithm>
+#include <stdexcept>
+#include "Parallel.h"
+
+
+/*!
+ * \brief Разбиение вершин на компоненты: номер компоненты у каждой вершины
+ *
+ * Компоненты нумеруются с 0 в порядке их наименьшей вершины, поэтому разные
+ * алгоритмы дают одинаковые номера. Для слабых компонент разные номера
+ * означают, что пути нет; для сильных одинаковые - что путь есть в обе стороны.
+ * @tparam csr_t CsrGraph или совместимое представление
+ */
+template<typename csr_t>
+class ComponentMap {
+public:
+    typedef typename csr_t::id_type id_type;
+
+    static constexpr id_type npos = csr_t::npos;
+
+private:
+    const csr_t* graph_ = nullptr;
+    std::shared_ptr<const csr_t> owner_;
+    std::vector<id_type> component_;
+    std::vector<std::size_t> sizes_;
+
+public:
+    ComponentMap() = default;
+
+    /*!
+     * \brief Компоненты по произвольным меткам: вершины с равной меткой (меньше graph.size()) - одна компонента
+     */
+    ComponentMap(const csr_t& graph, std::vector<id_type> label) : graph_(&graph), component_(std::move(label)) {
+        if (component_.size() != graph.size()) {
+            throw std::logic_error("components do not match the graph.\n");
+        }
+
+        std::vector<id_type> renamed(component_.size(), npos);
+        for (auto& c : component_) {
+            if (c >= renamed.size()) {
+                throw std::logic_error("components do not match the graph.\n");
+            }
+
+            if (renamed[c] == npos) {
+                renamed[c] = static_cast<id_type>(sizes_.size());
+                sizes_.push_back(0);
+            }
+            c = renamed[c];
+            sizes_[c]++;
+        }
+    }
+
+    /*!
+     * \brief Те же компоненты, но совместно владеющие снимком графа
+     */
+    ComponentMap(std::shared_ptr<const csr_t> graph, ComponentMap components) : ComponentMap(std::move(components)) {
+        if (graph.get() != graph_) {
+            throw std::logic_error("components do not match the graph.\n");
+        }
+
+        owner_ = std::move(graph);
+    }
+
+    const csr_t& graph() const {
+        return *graph_;
+    }
+
+    std::size_t count() const {
+        return sizes_.size();
+    }
+
+    id_type component(id_type id) const {
+        return component_[id];
+    }
+
+    std::size_t component_size(id_type component) const {
+        return sizes_[component];
+    }
+
+    /*!
+     * \brief Самая большая компонента (из равных - с меньшим номером); npos для пустого графа
+     */
+    id_type largest() const {
+        if (sizes_.empty()) {
+            return npos;
+        }
+
+        return static_cast<id_type>(std::max_element(sizes_.begin(), sizes_.end()) - sizes_.begin());
+    }
+
+    template<typename node_type_t>
+    id_type component_of(const node_type_t& key) const {
+        return component_[graph_->at(key)];
+    }
+
+    template<typename node_type_t>
+    bool connected(const node_type_t& key_a, const node_type_t& key_b) const {
+        return component_of(key_a) == component_of(key_b);
+    }
+
+    const std::vector<id_type>& components() const {
+        return component_;
+    }
+};
+
+
+/*!
+ * \brief Итеративный Тарьян по вершинам с label == npos; каждая найденная сильная
+ * компонента получает меткой свою корневую вершину. Остальные вершины и рёбра в них не трогаются.
+ */
+template<typename csr_t>
+void tarjan_label(const csr_t& graph, std::vector<typename csr_t::id_type>& label) {
+    typedef typename csr_t::id_type id_type;
+    constexpr id_type npos = csr_t::npos;
+
+    struct Frame {
+        id_type node;
+        std::size_t edge;
+    };
+
+    std::size_t n = graph.size();
+    std::vector<id_type> index(n, npos), low(n, npos);
+    std::vector<id_type> stack;
+    std::vector<Frame> frames;
+    id_type counter = 0;
+
+    auto open = [&](id_type v) {
+        index[v] = low[v] = counter++;
+        stack.push_back(v);
+        frames.push_back(Frame{v, graph.edge_begin(v)});
+    };
+
+    for (id_type s = 0; s < n; s++) {
+        if (label[s] != npos || index[s] != npos) {
+            continue;
+        }
+
+        open(s);
+        while (!frames.empty()) {
+            Frame& frame = frames.back();
+            id_type v = frame.node;
+
+            if (frame.edge < graph.edge_end(v)) {
+                id_type w = graph.target(frame.edge++);
+                if (label[w] != npos) {
+                    continue;
+                }
+
+                if (index[w] == npos) {
+                    open(w);
+                } else {
+                    // в стеке лежат ровно вершины без метки, уже получившие index
+                    low[v] = std::min(low[v], index[w]);
+                }
+                continue;
+            }
+
+            frames.pop_back();
+            if (!frames.empty()) {
+                id_type parent = frames.back().node;
+                low[parent] = std::min(low[parent], low[v]);
+            }
+
+            if (low[v] == index[v]) {
+                id_type w;
+                do {
+                    w = stack.back();
+                    stack.pop_back();
+                    label[w] = v;
+                } while (w != v);
+            }
+        }
+    }
+}
+
+/*!
+ * \brief Сильные компоненты итеративным алгоритмом Тарьяна за O(V + E), без рекурсии
+ */
+template<typename csr_t>
+ComponentMap<csr_t> tarjan_scc(const csr_t& graph) {
+    std::vector<typename csr_t::id_type> label(graph.size(), csr_t::npos);
+    tarjan_label(graph, label);
+
+    return ComponentMap<csr_t>(graph, std::move(label));
+}
+
+/*!
+ * \brief Сильные компоненты параллельно (по схеме Multistep)
+ *
+ * 1. Обрезка: вершины без входящих или без исходящих рёбер - отдельные
+ *    компоненты; обрезка идёт волнами, пока такие вершины появляются.
+ * 2. Прямой и обратный обход из вершины с наибольшей степенью: их
+ *    пересечение - обычно гигантская компонента.
+ * 3. Раскраска: наибольший номер вершины распространяется по рёбрам, и обратный
+ *    обход из каждой вершины, сохранившей свой цвет, внутри её цвета даёт компоненту.
+ *    Когда без метки остаётся мало вершин, их доделывает Тарьян.
+ * @param backward транспонированный forward (forward.transpose())
+ * @param threads число потоков, 0 - по числу ядер
+ */
+template<typename csr_t>
+ComponentMap<csr_t> parallel_scc(const csr_t& forward, const csr_t& backward, unsigned threads = 0) {
+    typedef typename csr_t::id_type id_type;
+    constexpr id_type npos = csr_t::npos;
+    constexpr std::size_t serial_tail = 1 << 14;
+
+    std::size_t n = forward.size();
+    if (backward.size() != n || backward.edge_count() != forward.edge_count()) {
+        throw std::logic_error("backward graph does not match.\n");
+    }
+
+    std::vector<id_type> label(n, npos);
+    ThreadPool pool(worker_count(threads, n, 1024));
+
+    // fn(worker, v) для всех v из items, кусками на все потоки пула
+    auto for_each = [&](const std::vector<id_type>& items, auto fn) {
+        std::size_t chunks = std::min<std::size_t>(items.size(), pool.size() * 8);
+        pool.run(chunks, [&](unsigned worker, std::size_t chunk) {
+            std::size_t lo = items.size() * chunk / chunks, hi = items.size() * (chunk + 1) / chunks;
+            for (std::size_t i = lo; i < hi; i++) {
+                fn(worker, items[i]);
+            }
+        });
+    };
+
+    std::vector<std::vector<id_type>> found(pool.size());
+    auto gather = [&](std::vector<id_type>& result) {
+        result.clear();
+        for (auto& part : found) {
+            result.insert(result.end(), part.begin(), part.end());
+            part.clear();
+        }
+    };
+
+    std::vector<id_type> all(n), frontier, active;
+    for (id_type v = 0; v < n; v++) {
+        all[v] = v;
+    }
+
+    // 1. обрезка по счётчикам степеней без петель
+    std::unique_ptr<std::atomic<id_type>[]> in(new std::atomic<id_type>[n]);
+    std::unique_ptr<std::atomic<id_type>[]> out(new std::atomic<id_type>[n]);
+    std::unique_ptr<std::atomic<std::uint8_t>[]> trimmed(new std::atomic<std::uint8_t>[n]);
+
+    auto degree = [](const csr_t& graph, id_type v) {
+        id_type result = 0;
+        for (std::size_t e = graph.edge_begin(v); e < graph.edge_end(v); e++) {
+            result += graph.target(e) != v;
+        }
+        return result;
+    };
+
+    for_each(all, [&](unsigned worker, id_type v) {
+        in[v].store(degree(backward, v), std::memory_order_relaxed);
+        out[v].store(degree(forward, v), std::memory_order_relaxed);
+        bool trim = in[v].load(std::memory_order_relaxed) == 0 || out[v].load(std::memory_order_relaxed) == 0;
+        trimmed[v].store(trim, std::memory_order_relaxed);
+        if (trim) {
+            found[worker].push_back(v);
+        }
+    });
+    gather(frontier);
+
+    while (!frontier.empty()) {
+        for (id_type v : frontier) {
+            label[v] = v;
+        }
+
+        auto release = [&](unsigned worker, const csr_t& graph, id_type v, std::atomic<id_type>* counter) {
+            for (std::size_t e = graph.edge_begin(v); e < graph.edge_end(v); e++) {
+                id_type w = graph.target(e);
+                if (w != v && counter[w].fetch_sub(1, std::memory_order_relaxed) == 1 &&
+                    trimmed[w].exchange(1, std::memory_order_relaxed) == 0) {
+                    found[worker].push_back(w);
+                }
+            }
+        };
+
+        for_each(frontier, [&](unsigned worker, id_type v) {
+            release(worker, forward, v, in.get());
+            release(worker, backward, v, out.get());
+        });
+        gather(frontier);
+    }
+
+    for (id_type v = 0; v < n; v++) {
+        if (label[v] == npos) {
+            active.push_back(v);
+        }
+    }
+
+    // 2. прямой обход из опорной вершины, затем обратный только по достигнутым вершинам
+    std::unique_ptr<std::atomic<std::uint8_t>[]> mark(new std::atomic<std::uint8_t>[n]);
+    if (!active.empty()) {
+        id_type pivot = active[0];
+        std::size_t best = 0;
+        for (id_type v : active) {
+            std::size_t weight = std::size_t(in[v].load(std::memory_order_relaxed) + 1) *
+                                 (out[v].load(std::memory_order_relaxed) + 1);
+            if (weight > best) {
+                best = weight;
+                pivot = v;
+            }
+        }
+
+        for_each(all, [&](unsigned, id_type v) {
+            mark[v].store(0, std::memory_order_relaxed);
+        });
+
+        // уровни обхода; вершину берёт тот, кто первым поднял её метку с from до to
+        auto sweep = [&](const csr_t& graph, std::uint8_t from, std::uint8_t to) {
+            mark[pivot].store(to, std::memory_order_relaxed);
+            frontier.assign(1, pivot);
+            while (!frontier.empty()) {
+                for_each(frontier, [&](unsigned worker, id_type v) {
+                    for (std::size_t e = graph.edge_begin(v); e < graph.edge_end(v); e++) {
+                        id_type w = graph.target(e);
+                        std::uint8_t expected = from;
+                        if (label[w] == npos && mark[w].load(std::memory_order_relaxed) == from &&
+                            mark[w].compare_exchange_strong(expected, to, std::memory_order_relaxed)) {
+                            found[worker].push_back(w);
+                        }
+                    }
+                });
+                gather(frontier);
+            }
+        };
+
+        sweep(forward, 0, 1);
+        sweep(backward, 1, 2);
+
+        std::vector<id_type> rest;
+        for (id_type v : active) {
+            if (mark[v].load(std::memory_order_relaxed) == 2) {
+                label[v] = pivot;
+            } else {
+                rest.push_back(v);
+            }
+        }
+        active.swap(rest);
+    }
+
+    // 3. раскраска, пока вершин без метки много
+    std::unique_ptr<std::atomic<id_type>[]> color(new std::atomic<id_type>[n]);
+    for_each(all, [&](unsigned, id_type v) {
+        color[v].store(npos, std::memory_order_relaxed);
+    });
+
+    while (active.size() > serial_tail && pool.size() > 1) {
+        for_each(active, [&](unsigned, id_type v) {
+            color[v].store(v, std::memory_order_relaxed);
+        });
+
+        for (bool changed = true; changed;) {
+            std::atomic<bool> any(false);
+            for_each(active, [&](unsigned, id_type v) {
+                id_type c = color[v].load(std::memory_order_relaxed);
+                for (std::size_t e = forward.edge_begin(v); e < forward.edge_end(v); e++) {
+                    id_type w = forward.target(e);
+                    if (label[w] != npos) {
+                        continue;
+                    }
+
+                    id_type current = color[w].load(std::memory_order_relaxed);
+                    while (current < c && !color[w].compare_exchange_weak(current, c, std::memory_order_relaxed)) {}
+                    if (current < c) {
+                        any.store(true, std::memory_order_relaxed);
+                    }
+                }
+            });
+            changed = any.load();
+        }
+
+        std::vector<id_type> roots;
+        for (id_type v : active) {
+            if (color[v].load(std::memory_order_relaxed) == v) {
+                roots.push_back(v);
+            }
+        }
+
+        // у каждой вершины один цвет, поэтому обходы разных корней не пересекаются
+        for_each(roots, [&](unsigned, id_type root) {
+            std::vector<id_type> stack(1, root);
+            label[root] = root;
+            while (!stack.empty()) {
+                id_type v = stack.back();
+                stack.pop_back();
+                for (std::size_t e = backward.edge_begin(v); e < backward.edge_end(v); e++) {
+                    id_type w = backward.target(e);
+                    if (color[w].load(std::memory_order_relaxed) == root && label[w] == npos) {
+                        label[w] = root;
+                        stack.push_back(w);
+                    }
+                }
+            }
+        });
+
+        std::vector<id_type> rest;
+        for (id_type v : active) {
+            if (label[v] == npos) {
+                rest.push_back(v);
+            }
+        }
+        active.swap(rest);
+    }
+
+    tarjan_label(forward, label);
+
+    return ComponentMap<csr_t>(forward, std::move(label));
+}
+
+/*!
+ * \brief Слабые компоненты (направление рёбер не учитывается) параллельным
+ * объединением множеств без блокировок: корень - меньшая вершина, пути сжимаются делением пополам
+ * @param threads число потоков, 0 - по числу ядер
+ */
+template<typename csr_t>
+ComponentMap<csr_t> parallel_wcc(const csr_t& graph, unsigned threads = 0) {
+    typedef typename csr_t::id_type id_type;
+
+    std::size_t n = graph.size();
+    std::unique_ptr<std::atomic<id_type>[]> parent(new std::atomic<id_type>[n]);
+    for (id_type v = 0; v < n; v++) {
+        parent[v].store(v, std::memory_order_relaxed);
+    }
+
+    auto find = [&](id_type v) {
+        for (;;) {
+            id_type p = parent[v].load(std::memory_order_relaxed);
+            if (p == v) {
+                return v;
+            }
+
+            id_type grand = parent[p].load(std::memory_order_relaxed);
+            if (grand != p) {
+                parent[v].compare_exchange_weak(p, grand, std::memory_order_relaxed);
+            }
+            v = grand;
+        }
+    };
+
+    auto unite = [&](id_type a, id_type b) {
+        for (;;) {
+            a = find(a);
+            b = find(b);
+            if (a == b) {
+                return;
+            }
+
+            if (a < b) {
+                std::swap(a, b);
+            }
+
+            // подвешиваем больший корень под меньший; если a уже не корень - повторяем
+            id_type expected = a;
+            if (parent[a].compare_exchange_strong(expected, b, std::memory_order_relaxed)) {
+                return;
+            }
+        }
+    };
+
+    unsigned workers = worker_count(threads, graph.edge_count() + n, 1 << 14);
+    parallel_for(0, n, workers, [&](unsigned, std::size_t lo, std::size_t hi) {
+        for (std::size_t v = lo; v < hi; v++) {
+            for (std::size_t e = graph.edge_begin(v); e < graph.edge_end(v); e++) {
+                unite(static_cast<id_type>(v), graph.target(e));
+            }
+        }
+    });
+
+    std::vector<id_type> label(n);
+    parallel_for(0, n, workers, [&](unsigned, std::size_t lo, std::size_t hi) {
+        for (std::size_t v = lo; v < hi; v++) {
+            label[v] = find(static_cast<id_type>(v));
+        }
+    });
+
+    return ComponentMap<csr_t>(graph, std::move(label));
+}
@@ -0,0 +1,479 @@
+#pragma once
+
+#include <vector>
+#include <memory>
+#include <limits>
+#include <cstdint>
+#include <utility>
+#include <algorithm>
+#include <stdexcept>
+#include <type_traits>
+#include "DaryHeap.h"
+
+
+/*!
+ * \brief Иерархия сжатий (Contraction Hierarchies) над CSR-снимком графа
+ *
+ * Предобработка сжимает вершины по одной в порядке edge difference (число
+ * добавляемых shortcut-рёбер минус число удаляемых рёбер плюс число уже сжатых
+ * соседей, с ленивым пересчётом). Shortcut u -> w через v добавляется, только
+ * если ограниченный поиск-свидетель не нашёл обхода не длиннее. Запрос -
+ * двунаправленный Дейкстра только по рёбрам "вверх" по иерархии; shortcut-рёбра
+ * в ответе разворачиваются обратно в исходные.
+ * Снимок графа должен жить, пока используется иерархия (из него берутся ключи),
+ * если иерархия не владеет им сама (см. contraction_hierarchy() в Graph.h).
+ * @tparam csr_t CsrGraph или совместимое представление
+ */
+template<typename csr_t>
+class ContractionHierarchy {
+public:
+    typedef typename csr_t::id_type id_type;
+    typedef std::decay_t<decltype(std::declval<const csr_t&>().weight(0))> weight_type;
+
+    static constexpr id_type npos = csr_t::npos;
+
+private:
+    struct Arc {
+        id_type to;
+        weight_type weight;
+        id_type middle; // npos - исходное ребро, иначе shortcut через middle
+    };
+
+    struct Side {
+        const std::vector<std::size_t>* offsets;
+        const std::vector<Arc>* arcs;
+        std::vector<weight_type> dist;
+        std::vector<id_type> parent;
+        std::vector<std::size_t> arc;
+        std::vector<std::uint32_t> stamp;
+        DaryHeap<weight_type> heap;
+    };
+
+    const csr_t* graph_;
+    std::shared_ptr<const csr_t> owner_;
+    std::vector<id_type> rank_;
+
+    // up_: рёбра v -> u в вершины выше по иерархии; down_: рёбра u -> v из вершин выше,
+    // хранятся у v и указывают на u
+    std::vector<std::size_t> up_offsets_;
+    std::vector<Arc> up_;
+    std::vector<std::size_t> down_offsets_;
+    std::vector<Arc> down_;
+    std::size_t shortcuts_ = 0;
+
+    Side forward_;
+    Side backward_;
+    std::uint32_t current_ = 0;
+    id_type meet_ = npos;
+    weight_type best_ = weight_type();
+
+    static void add_arc(std::vector<Arc>& arcs, id_type to, weight_type weight, id_type middle) {
+        for (auto& arc : arcs) {
+            if (arc.to == to) {
+                if (weight < arc.weight) {
+                    arc.weight = weight;
+                    arc.middle = middle;
+                }
+                return;
+            }
+        }
+
+        arcs.push_back(Arc{to, weight, middle});
+    }
+
+    static void remove_arc(std::vector<Arc>& arcs, id_type to) {
+        for (std::size_t i = 0; i < arcs.size(); i++) {
+            if (arcs[i].to == to) {
+                arcs[i] = arcs.back();
+                arcs.pop_back();
+                return;
+            }
+        }
+    }
+
+    /*!
+     * \brief Состояние предобработки: динамическая смежность ещё не сжатых вершин
+     */
+    struct Builder {
+        std::vector<std::vector<Arc>> out;
+        std::vector<std::vector<Arc>> in;
+        std::vector<char> contracted;
+        std::vector<int> deleted;
+
+        std::vector<weight_type> dist;
+        std::vector<std::uint32_t> stamp;
+        std::uint32_t current = 0;
+        DaryHeap<weight_type> heap;
+        std::size_t witness_limit;
+
+        Builder(std::size_t n, std::size_t limit)
+                : out(n), in(n), contracted(n, 0), deleted(n, 0), dist(n), stamp(n, 0), heap(n), witness_limit(limit) {}
+
+        // Дейкстра из source по несжатым вершинам в обход skip, не дальше limit
+        void witness(id_type source, id_type skip, weight_type limit) {
+            heap.clear();
+            if (++current == 0) {
+                std::fill(stamp.begin(), stamp.end(), 0);
+                current = 1;
+            }
+
+            stamp[source] = current;
+            dist[source] = weight_type();
+            heap.push(source, weight_type());
+
+            for (std::size_t settled = 0; !heap.empty() && settled < witness_limit; settled++) {
+                if (limit < heap.top_priority()) {
+                    break;
+                }
+
+                id_type v = heap.pop();
+                for (const auto& arc : out[v]) {
+                    if (arc.to == skip || contracted[arc.to]) {
+                        continue;
+                    }
+
+                    weight_type candidate = dist[v] + arc.weight;
+                    if (stamp[arc.to] != current) {
+                        stamp[arc.to] = current;
+                        dist[arc.to] = candidate;
+                        heap.push(arc.to, candidate);
+                    } else if (candidate < dist[arc.to] && heap.contains(arc.to)) {
+                        dist[arc.to] = candidate;
+                        heap.decrease(arc.to, candidate);
+                    }
+                }
+            }
+        }
+
+        /*!
+         * \brief Сжать v (или только посчитать нужные shortcut-рёбра при simulate)
+         * @return число shortcut-рёбер
+         */
+        std::size_t contract(id_type v, bool simulate) {
+            std::size_t added = 0;
+
+            for (const auto& in_arc : in[v]) {
+                id_type u = in_arc.to;
+
+                weight_type limit = weight_type();
+                bool any = false;
+                for (const auto& out_arc : out[v]) {
+                    if (out_arc.to != u && (!any || limit < in_arc.weight + out_arc.weight)) {
+                        limit = in_arc.weight + out_arc.weight;
+                        any = true;
+                    }
+                }
+                if (!any) {
+                    continue;
+                }
+
+                witness(u, v, limit);
+
+                for (const auto& out_arc : out[v]) {
+                    id_type w = out_arc.to;
+                    if (w == u) {
+                        continue;
+                    }
+
+                    weight_type through = in_arc.weight + out_arc.weight;
+                    if (stamp[w] == current && !(through < dist[w])) {
+                        continue;
+                    }
+
+                    added++;
+                    if (!simulate) {
+                        add_arc(out[u], w, through, v);
+                        add_arc(in[w], u, through, v);
+                    }
+                }
+            }
+
+            return added;
+        }
+
+        long long priority(id_type v) {
+            long long shortcuts = static_cast<long long>(contract(v, true));
+            return shortcuts - static_cast<long long>(in[v].size() + out[v].size()) + deleted[v];
+        }
+    };
+
+    void build(std::size_t witness_limit) {
+        std::size_t n = graph_->size();
+        Builder builder(n, witness_limit);
+
+        for (id_type v = 0; v < n; v++) {
+            for (std::size_t e = graph_->edge_begin(v), end = graph_->edge_end(v); e < end; e++) {
+                id_type to = graph_->target(e);
+                const weight_type& weight = graph_->weight(e);
+                if (weight < 0) {
+                    throw std::logic_error("negative weight.\n");
+                }
+                if (to == v) {
+                    continue; // петля не лежит ни на одном кратчайшем пути
+                }
+
+                add_arc(builder.out[v], to, weight, npos);
+                add_arc(builder.in[to], v, weight, npos);
+            }
+        }
+
+        std::vector<std::vector<Arc>> up(n), down(n);
+        rank_.assign(n, 0);
+
+        DaryHeap<long long> queue(n);
+        for (id_type v = 0; v < n; v++) {
+            queue.push(v, builder.priority(v));
+        }
+
+        id_type next_rank = 0;
+        while (!queue.empty()) {
+            id_type v = queue.pop();
+
+            // ленивый пересчёт: приоритет мог устареть после сжатия соседей
+            long long priority = builder.priority(v);
+            if (!queue.empty() && queue.top_priority() < priority) {
+                queue.push(v, priority);
+                continue;
+            }
+
+            builder.contract(v, false);
+            builder.contracted[v] = 1;
+            rank_[v] = next_rank++;
+
+            for (const auto& arc : builder.out[v]) {
+                remove_arc(builder.in[arc.to], v);
+                builder.deleted[arc.to]++;
+            }
+            for (const auto& arc : builder.in[v]) {
+                remove_arc(builder.out[arc.to], v);
+                builder.deleted[arc.to]++;
+            }
+
+            up[v] = std::move(builder.out[v]);
+            down[v] = std::move(builder.in[v]);
+            builder.out[v] = std::vector<Arc>();
+            builder.in[v] = std::vector<Arc>();
+        }
+
+        up_offsets_.assign(1, 0);
+        down_offsets_.assign(1, 0);
+        for (id_type v = 0; v < n; v++) {
+            up_.insert(up_.end(), up[v].begin(), up[v].end());
+            down_.insert(down_.end(), down[v].begin(), down[v].end());
+            up_offsets_.push_back(up_.size());
+            down_offsets_.push_back(down_.size());
+        }
+
+        // каждое ребро иерархии хранится ровно в одном из up_ и down_
+        shortcuts_ = 0;
+        for (const auto* arcs : {&up_, &down_}) {
+            for (const auto& arc : *arcs) {
+                shortcuts_ += arc.middle != npos;
+            }
+        }
+    }
+
+    // ребро a -> b в итоговой иерархии: у младшей по рангу вершины из двух
+    const Arc& find_arc(id_type a, id_type b) const {
+        if (rank_[a] < rank_[b]) {
+            for (std::size_t i = up_offsets_[a]; i < up_offsets_[a + 1]; i++) {
+                if (up_[i].to == b) {
+                    return up_[i];
+                }
+            }
+        } else {
+            for (std::size_t i = down_offsets_[b]; i < down_offsets_[b + 1]; i++) {
+                if (down_[i].to == a) {
+                    return down_[i];
+                }
+            }
+        }
+
+        throw std::logic_error("broken contraction hierarchy.\n");
+    }
+
+    // развернуть ребро a -> b (возможно, shortcut) и дописать в route вершины после a
+    template<typename route_t>
+    void unpack(id_type a, id_type b, id_type middle, route_t& route) const {
+        std::vector<std::pair<id_type, id_type>> stack;
+        std::vector<id_type> middles;
+        stack.emplace_back(a, b);
+        middles.push_back(middle);
+
+        while (!stack.empty()) {
+            auto [from, to] = stack.back();
+            id_type via = middles.back();
+            stack.pop_back();
+            middles.pop_back();
+
+            if (via == npos) {
+                route.push_back(graph_->key(to));
+                continue;
+            }
+
+            // сначала обрабатывается левая половина from -> via
+            stack.emplace_back(via, to);
+            middles.push_back(find_arc(via, to).middle);
+            stack.emplace_back(from, via);
+            middles.push_back(find_arc(from, via).middle);
+        }
+    }
+
+    void prepare(Side& side, const std::vector<std::size_t>& offsets, const std::vector<Arc>& arcs) {
+        std::size_t n = graph_->size();
+        side.offsets = &offsets;
+        side.arcs = &arcs;
+        side.dist.assign(n, weight_type());
+        side.parent.assign(n, npos);
+        side.arc.assign(n, 0);
+        side.stamp.assign(n, 0);
+        side.heap.resize(n);
+    }
+
+    void step(Side& side, const Side& other) {
+        id_type v = side.heap.pop();
+        weight_type dv = side.dist[v];
+
+        for (std::size_t i = (*side.offsets)[v]; i < (*side.offsets)[v + 1]; i++) {
+            const Arc& arc = (*side.arcs)[i];
+            weight_type candidate = dv + arc.weight;
+
+            if (side.stamp[arc.to] != current_) {
+                side.stamp[arc.to] = current_;
+                side.heap.push(arc.to, candidate);
+            } else if (candidate < side.dist[arc.to] && side.heap.contains(arc.to)) {
+                side.heap.decrease(arc.to, candidate);
+            } else {
+                continue;
+            }
+
+            side.dist[arc.to] = candidate;
+            side.parent[arc.to] = v;
+            side.arc[arc.to] = i;
+
+            if (other.stamp[arc.to] == current_) {
+                weight_type through = candidate + other.dist[arc.to];
+                if (meet_ == npos || through < best_) {
+                    best_ = through;
+                    meet_ = arc.to;
+                }
+            }
+        }
+    }
+
+public:
+    /*!
+     * \brief Предобработка графа
+     * @param witness_limit сколько вершин может просмотреть один поиск-свидетель;
+     * меньше - быстрее предобработка, но больше лишних shortcut-рёбер
+     */
+    explicit ContractionHierarchy(const csr_t& graph, std::size_t witness_limit = 500) : graph_(&graph) {
+        build(witness_limit);
+        prepare(forward_, up_offsets_, up_);
+        prepare(backward_, down_offsets_, down_);
+    }
+
+    /*!
+     * \brief То же, но иерархия совместно владеет снимком графа
+     */
+    explicit ContractionHierarchy(std::shared_ptr<const csr_t> graph, std::size_t witness_limit = 500)
+            : ContractionHierarchy(*graph, witness_limit) {
+        owner_ = std::move(graph);
+    }
+
+    ContractionHierarchy(const ContractionHierarchy& other) = delete;
+
+    ContractionHierarchy& operator=(const ContractionHierarchy& rhs) = delete;
+
+    const csr_t& graph() const {
+        return *graph_;
+    }
+
+    std::size_t shortcut_count() const {
+        return shortcuts_;
+    }
+
+    id_type rank(id_type id) const {
+        return rank_[id];
+    }
+
+    /*!
+     * \brief Поиск пути source -> target только по рёбрам вверх по иерархии
+     * @return true, если путь есть
+     */
+    bool run(id_type source, id_type target) {
+        forward_.heap.clear();
+        backward_.heap.clear();
+        if (++current_ == 0) {
+            std::fill(forward_.stamp.begin(), forward_.stamp.end(), 0);
+            std::fill(backward_.stamp.begin(), backward_.stamp.end(), 0);
+            current_ = 1;
+        }
+
+        for (auto [side, id] : {std::pair<Side*, id_type>(&forward_, source), std::pair<Side*, id_type>(&backward_, target)}) {
+            side->stamp[id] = current_;
+            side->dist[id] = weight_type();
+            side->parent[id] = npos;
+            side->heap.push(id, weight_type());
+        }
+
+        meet_ = source == target ? source : npos;
+        best_ = weight_type();
+
+        for (;;) {
+            bool go_forward = !forward_.heap.empty() && (meet_ == npos || forward_.heap.top_priority() < best_);
+            bool go_backward = !backward_.heap.empty() && (meet_ == npos || backward_.heap.top_priority() < best_);
+
+            if (go_forward && (!go_backward || forward_.heap.size() <= backward_.heap.size())) {
+                step(forward_, backward_);
+            } else if (go_backward) {
+                step(backward_, forward_);
+            } else {
+                break;
+            }
+        }
+
+        return meet_ != npos;
+    }
+
+    const weight_type& distance() const {
+        return best_;
+    }
+
+    /*!
+     * \brief Маршрут последнего поиска в исходных рёбрах (shortcut-рёбра развёрнуты)
+     */
+    template<typename route_t>
+    route_t route() const {
+        std::vector<id_type> chain;
+        for (id_type v = meet_; v != npos; v = forward_.parent[v]) {
+            chain.push_back(v);
+        }
+        std::reverse(chain.begin(), chain.end());
+
+        route_t result;
+        result.push_back(graph_->key(chain.front()));
+
+        for (std::size_t i = 1; i < chain.size(); i++) {
+            unpack(chain[i - 1], chain[i], up_[forward_.arc[chain[i]]].middle, result);
+        }
+
+        for (id_type v = meet_; backward_.parent[v] != npos; v = backward_.parent[v]) {
+            unpack(v, backward_.parent[v], down_[backward_.arc[v]].middle, result);
+        }
+
+        return result;
+    }
+
+    template<typename route_t, typename node_type_t>
+    std::pair<weight_type, route_t> query(const node_type_t& key_from, const node_type_t& key_to) {
+        id_type from = graph_->at(key_from);
+        id_type to = graph_->at(key_to);
+
+        if (!run(from, to)) {
+            throw std::logic_error("no route.\n");
+        }
+
+        return std::pair<weight_type, route_t>(best_, route<route_t>());
+    }
+};
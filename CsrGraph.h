@@ -0,0 +1,220 @@
+#pragma once
+
+#include <vector>
+#include <algorithm>
+#include <limits>
+#include <cstdint>
+#include <stdexcept>
+#include <type_traits>
+#include <utility>
+
+
+/*!
+ * \brief Неизменяемый снимок графа в формате CSR (compressed sparse row)
+ *
+ * Вершины нумеруются плотными id в порядке возрастания ключей, рёбра вершины id
+ * лежат подряд в targets/weights на отрезке [edge_begin(id), edge_end(id)).
+ * @tparam key_type
+ * @tparam value_type
+ * @tparam weight_type
+ */
+template<typename key_type, typename value_type, typename weight_type>
+class CsrGraph {
+public:
+    typedef std::uint32_t id_type;
+
+    static constexpr id_type npos = std::numeric_limits<id_type>::max();
+
+private:
+    std::vector<key_type> keys_;
+    std::vector<value_type> values_;
+    std::vector<std::size_t> offsets_;
+    std::vector<id_type> targets_;
+    std::vector<weight_type> weights_;
+
+public:
+    CsrGraph() : offsets_(1, 0) {}
+
+    /*!
+     * \brief Снимок произвольного графа с интерфейсом Graph
+     */
+    template<typename graph_t>
+    explicit CsrGraph(const graph_t& graph) {
+        using node_t = std::decay_t<decltype(graph.begin()->second)>;
+
+        std::vector<std::pair<const key_type*, const node_t*>> nodes;
+        nodes.reserve(graph.size());
+        for (const auto& [key, node] : graph) {
+            nodes.emplace_back(&key, &node);
+        }
+
+        auto by_key = [](const auto& lhs, const auto& rhs) { return *lhs.first < *rhs.first; };
+        if (!std::is_sorted(nodes.begin(), nodes.end(), by_key)) {
+            std::sort(nodes.begin(), nodes.end(), by_key);
+        }
+
+        if (nodes.size() >= npos) {
+            throw std::length_error("too many nodes for csr graph.\n");
+        }
+
+        keys_.reserve(nodes.size());
+        values_.reserve(nodes.size());
+        offsets_.reserve(nodes.size() + 1);
+
+        std::size_t edges = 0;
+        for (auto [key, node] : nodes) {
+            keys_.push_back(*key);
+            values_.push_back(node->value());
+            edges += node->size();
+        }
+
+        targets_.reserve(edges);
+        weights_.reserve(edges);
+        offsets_.push_back(0);
+
+        for (auto [key, node] : nodes) {
+            for (const auto& [to, weight] : *node) {
+                id_type to_id = id(to);
+                if (to_id == npos) {
+                    continue; // ребро в удалённую вершину в снимок не попадает
+                }
+                targets_.push_back(to_id);
+                weights_.push_back(weight);
+            }
+            offsets_.push_back(targets_.size());
+        }
+    }
+
+    /*!
+     * \brief Сборка из готовых массивов; offsets.size() == keys.size() + 1, keys отсортированы
+     */
+    CsrGraph(std::vector<key_type> keys, std::vector<value_type> values, std::vector<std::size_t> offsets,
+             std::vector<id_type> targets, std::vector<weight_type> weights)
+            : keys_(std::move(keys)), values_(std::move(values)), offsets_(std::move(offsets)),
+              targets_(std::move(targets)), weights_(std::move(weights)) {
+        if (offsets_.size() != keys_.size() + 1 || values_.size() != keys_.size() ||
+            targets_.size() != weights_.size() || offsets_.back() != targets_.size()) {
+            throw std::logic_error("inconsistent csr arrays.\n");
+        }
+    }
+
+    CsrGraph(const CsrGraph& other) = default;
+
+    CsrGraph(CsrGraph&& other) noexcept = default;
+
+    CsrGraph& operator=(const CsrGraph& rhs) = default;
+
+    CsrGraph& operator=(CsrGraph&& rhs) noexcept = default;
+
+    bool empty() const {
+        return keys_.empty();
+    }
+
+    std::size_t size() const {
+        return keys_.size();
+    }
+
+    std::size_t edge_count() const {
+        return targets_.size();
+    }
+
+    /*!
+     * \brief Плотный id вершины по ключу, npos если вершины нет
+     */
+    id_type id(const key_type& key) const {
+        auto it = std::lower_bound(keys_.begin(), keys_.end(), key);
+        if (it == keys_.end() || key < *it) {
+            return npos;
+        }
+
+        return static_cast<id_type>(it - keys_.begin());
+    }
+
+    bool contains(const key_type& key) const {
+        return id(key) != npos;
+    }
+
+    id_type at(const key_type& key) const {
+        id_type result = id(key);
+        if (result == npos) {
+            throw std::logic_error("no such node.\n");
+        }
+
+        return result;
+    }
+
+    const key_type& key(id_type id) const {
+        return keys_[id];
+    }
+
+    const value_type& value(id_type id) const {
+        return values_[id];
+    }
+
+    std::size_t degree_out(id_type id) const {
+        return offsets_[id + 1] - offsets_[id];
+    }
+
+    std::size_t edge_begin(id_type id) const {
+        return offsets_[id];
+    }
+
+    std::size_t edge_end(id_type id) const {
+        return offsets_[id + 1];
+    }
+
+    id_type target(std::size_t edge) const {
+        return targets_[edge];
+    }
+
+    const weight_type& weight(std::size_t edge) const {
+        return weights_[edge];
+    }
+
+    /*!
+     * \brief Граф с развёрнутыми рёбрами (те же id вершин): обратная смежность для поиска от цели
+     */
+    CsrGraph transpose() const {
+        std::vector<std::size_t> offsets(size() + 1, 0);
+        for (id_type to : targets_) {
+            offsets[to + 1]++;
+        }
+        for (std::size_t id = 0; id < size(); id++) {
+            offsets[id + 1] += offsets[id];
+        }
+
+        std::vector<id_type> targets(edge_count());
+        std::vector<weight_type> weights(edge_count());
+        std::vector<std::size_t> next(offsets.begin(), offsets.end() - 1);
+
+        for (id_type from = 0; from < size(); from++) {
+            for (std::size_t e = offsets_[from]; e < offsets_[from + 1]; e++) {
+                std::size_t place = next[targets_[e]]++;
+                targets[place] = from;
+                weights[place] = weights_[e];
+            }
+        }
+
+        return CsrGraph(keys_, values_, std::move(offsets), std::move(targets), std::move(weights));
+    }
+
+    const std::vector<key_type>& keys() const {
+        return keys_;
+    }
+
+    const std::vector<value_type>& values() const {
+        return values_;
+    }
+
+    const std::vector<std::size_t>& offsets() const {
+        return offsets_;
+    }
+
+    const std::vector<id_type>& targets() const {
+        return targets_;
+    }
+
+    const std::vector<weight_type>& weights() const {
+        return weights_;
+    }
+};
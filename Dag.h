@@ -0,0 +1,255 @@
+#pragma once
+
+#include <vector>
+#include <cstdint>
+#include <utility>
+#include <algorithm>
+#include <stdexcept>
+#include <type_traits>
+#include "ShortestPathTree.h"
+
+
+/*!
+ * \brief Что искать в ациклическом графе: кратчайшие или длиннейшие (критические) пути
+ */
+enum class dag_objective {
+    shortest,
+    longest
+};
+
+
+/*!
+ * \brief Топологический порядок алгоритмом Кана за O(V + E)
+ * @param order сюда пишется порядок; при цикле - только вершины, не зависящие от цикла
+ * @return false, если в графе есть цикл
+ */
+template<typename csr_t>
+bool topological_order(const csr_t& graph, std::vector<typename csr_t::id_type>& order) {
+    typedef typename csr_t::id_type id_type;
+
+    std::vector<id_type> in(graph.size(), 0);
+    for (std::size_t e = 0; e < graph.edge_count(); e++) {
+        in[graph.target(e)]++;
+    }
+
+    order.clear();
+    order.reserve(graph.size());
+    for (id_type v = 0; v < graph.size(); v++) {
+        if (in[v] == 0) {
+            order.push_back(v);
+        }
+    }
+
+    // order сам служит очередью
+    for (std::size_t i = 0; i < order.size(); i++) {
+        id_type v = order[i];
+        for (std::size_t e = graph.edge_begin(v), end = graph.edge_end(v); e < end; e++) {
+            if (--in[graph.target(e)] == 0) {
+                order.push_back(graph.target(e));
+            }
+        }
+    }
+
+    return order.size() == graph.size();
+}
+
+
+/*!
+ * \brief Кратчайшие и длиннейшие пути в ациклическом графе одним проходом в топологическом порядке
+ *
+ * Каждый поиск - O(V + E) без очереди с приоритетами; отрицательные веса
+ * допустимы. Порядок считается один раз в конструкторе, граф с циклом
+ * отвергается исключением "graph has a cycle.".
+ * @tparam csr_t CsrGraph или совместимое представление
+ */
+template<typename csr_t>
+class DagPathEngine {
+public:
+    typedef typename csr_t::id_type id_type;
+    typedef std::decay_t<decltype(std::declval<const csr_t&>().weight(0))> weight_type;
+
+    static constexpr id_type npos = csr_t::npos;
+
+private:
+    const csr_t* graph_;
+    std::vector<id_type> order_;
+    std::vector<id_type> position_;
+    std::vector<weight_type> dist_;
+    std::vector<id_type> parent_;
+    std::vector<std::uint32_t> stamp_;
+    std::uint32_t current_ = 0;
+    id_type source_ = npos;
+
+    void next_generation() {
+        if (++current_ == 0) {
+            std::fill(stamp_.begin(), stamp_.end(), 0);
+            current_ = 1;
+        }
+    }
+
+    static bool better(const weight_type& candidate, const weight_type& current, dag_objective objective) {
+        return objective == dag_objective::shortest ? candidate < current : current < candidate;
+    }
+
+public:
+    explicit DagPathEngine(const csr_t& graph)
+            : graph_(&graph), position_(graph.size()), dist_(graph.size()), parent_(graph.size(), npos),
+              stamp_(graph.size(), 0) {
+        if (!topological_order(graph, order_)) {
+            throw std::logic_error("graph has a cycle.\n");
+        }
+
+        for (std::size_t i = 0; i < order_.size(); i++) {
+            position_[order_[i]] = static_cast<id_type>(i);
+        }
+    }
+
+    const csr_t& graph() const {
+        return *graph_;
+    }
+
+    /*!
+     * \brief Топологический порядок: каждое ребро ведёт от более ранней вершины к более поздней
+     */
+    const std::vector<id_type>& order() const {
+        return order_;
+    }
+
+    /*!
+     * \brief Пути из source до всех достижимых вершин; просматривается только хвост порядка, начиная с source
+     */
+    void run(id_type source, dag_objective objective = dag_objective::shortest) {
+        next_generation();
+
+        source_ = source;
+        stamp_[source] = current_;
+        dist_[source] = weight_type();
+        parent_[source] = npos;
+
+        for (std::size_t i = position_[source]; i < order_.size(); i++) {
+            id_type v = order_[i];
+            if (stamp_[v] != current_) {
+                continue;
+            }
+
+            weight_type dv = dist_[v];
+            for (std::size_t e = graph_->edge_begin(v), end = graph_->edge_end(v); e < end; e++) {
+                id_type to = graph_->target(e);
+                weight_type candidate = dv + graph_->weight(e);
+
+                if (stamp_[to] != current_ || better(candidate, dist_[to], objective)) {
+                    stamp_[to] = current_;
+                    dist_[to] = candidate;
+                    parent_[to] = v;
+                }
+            }
+        }
+    }
+
+    bool reached(id_type id) const {
+        return stamp_[id] == current_;
+    }
+
+    const weight_type& distance(id_type id) const {
+        return dist_[id];
+    }
+
+    id_type parent(id_type id) const {
+        return parent_[id];
+    }
+
+    /*!
+     * \brief Маршрут (ключи вершин) от источника последнего поиска до target
+     */
+    template<typename route_t>
+    route_t route(id_type target) const {
+        route_t result;
+
+        for (id_type v = target; v != npos; v = parent_[v]) {
+            result.push_back(graph_->key(v));
+        }
+
+        std::reverse(result.begin(), result.end());
+        return result;
+    }
+
+    /*!
+     * \brief Кратчайший (или длиннейший) путь между ключами
+     */
+    template<typename route_t, typename node_type_t>
+    std::pair<weight_type, route_t> query(const node_type_t& key_from, const node_type_t& key_to,
+                                          dag_objective objective = dag_objective::shortest) {
+        id_type from = graph_->at(key_from);
+        id_type to = graph_->at(key_to);
+
+        run(from, objective);
+        if (!reached(to)) {
+            throw std::logic_error("no route.\n");
+        }
+
+        return std::pair<weight_type, route_t>(dist_[to], route<route_t>(to));
+    }
+
+    /*!
+     * \brief Дерево путей последнего поиска
+     */
+    ShortestPathTree<csr_t> tree() const {
+        std::vector<weight_type> dist(graph_->size(), weight_type());
+        std::vector<id_type> parent(graph_->size(), npos);
+
+        for (id_type v = 0; v < stamp_.size(); v++) {
+            if (stamp_[v] == current_) {
+                dist[v] = dist_[v];
+                parent[v] = parent_[v];
+            }
+        }
+
+        return ShortestPathTree<csr_t>(*graph_, source_, std::move(dist), std::move(parent));
+    }
+
+    template<typename node_type_t>
+    ShortestPathTree<csr_t> tree(const node_type_t& key_from, dag_objective objective = dag_objective::shortest) {
+        run(graph_->at(key_from), objective);
+        return tree();
+    }
+
+    /*!
+     * \brief Критический путь: самый длинный путь во всём графе, начинающийся где угодно
+     *
+     * Состояние последнего поиска не меняется. Для пустого графа бросается "no route.".
+     */
+    template<typename route_t>
+    std::pair<weight_type, route_t> critical_path() const {
+        if (order_.empty()) {
+            throw std::logic_error("no route.\n");
+        }
+
+        std::vector<weight_type> dist(graph_->size(), weight_type());
+        std::vector<id_type> parent(graph_->size(), npos);
+        id_type best = order_[0];
+
+        for (id_type v : order_) {
+            if (dist[best] < dist[v]) {
+                best = v;
+            }
+
+            for (std::size_t e = graph_->edge_begin(v), end = graph_->edge_end(v); e < end; e++) {
+                id_type to = graph_->target(e);
+                weight_type candidate = dist[v] + graph_->weight(e);
+
+                if (dist[to] < candidate) {
+                    dist[to] = candidate;
+                    parent[to] = v;
+                }
+            }
+        }
+
+        route_t result;
+        for (id_type v = best; v != npos; v = parent[v]) {
+            result.push_back(graph_->key(v));
+        }
+
+        std::reverse(result.begin(), result.end());
+        return std::pair<weight_type, route_t>(dist[best], std::move(result));
+    }
+};
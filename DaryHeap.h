@@ -0,0 +1,168 @@
+#pragma once
+
+#include <vector>
+#include <limits>
+#include <cstdint>
+#include <utility>
+
+
+/*!
+ * \brief Индексированная d-арная min-куча над плотными id с decrease-key
+ * @tparam priority_type
+ * @tparam arity
+ */
+template<typename priority_type, unsigned arity = 4>
+class DaryHeap {
+    static_assert(arity >= 2, "heap arity must be at least 2");
+
+public:
+    typedef std::uint32_t id_type;
+
+    static constexpr id_type npos = std::numeric_limits<id_type>::max();
+
+private:
+    std::vector<std::pair<priority_type, id_type>> heap_;
+    std::vector<id_type> pos_;
+
+    void place(std::size_t index, const std::pair<priority_type, id_type>& item) {
+        heap_[index] = item;
+        pos_[item.second] = static_cast<id_type>(index);
+    }
+
+    void sift_up(std::size_t index) {
+        auto item = heap_[index];
+
+        while (index > 0) {
+            std::size_t parent = (index - 1) / arity;
+            if (!(item.first < heap_[parent].first)) {
+                break;
+            }
+            place(index, heap_[parent]);
+            index = parent;
+        }
+
+        place(index, item);
+    }
+
+    void sift_down(std::size_t index) {
+        auto item = heap_[index];
+        std::size_t count = heap_.size();
+
+        for (;;) {
+            std::size_t first = index * arity + 1;
+            if (first >= count) {
+                break;
+            }
+
+            std::size_t last = first + arity < count ? first + arity : count;
+            std::size_t best = first;
+            for (std::size_t child = first + 1; child < last; child++) {
+                if (heap_[child].first < heap_[best].first) {
+                    best = child;
+                }
+            }
+
+            if (!(heap_[best].first < item.first)) {
+                break;
+            }
+            place(index, heap_[best]);
+            index = best;
+        }
+
+        place(index, item);
+    }
+
+public:
+    DaryHeap() = default;
+
+    explicit DaryHeap(std::size_t capacity) : pos_(capacity, npos) {}
+
+    /*!
+     * \brief Диапазон допустимых id [0, capacity), куча при этом очищается
+     */
+    void resize(std::size_t capacity) {
+        heap_.clear();
+        pos_.assign(capacity, npos);
+    }
+
+    std::size_t capacity() const {
+        return pos_.size();
+    }
+
+    bool empty() const {
+        return heap_.empty();
+    }
+
+    std::size_t size() const {
+        return heap_.size();
+    }
+
+    bool contains(id_type id) const {
+        return pos_[id] != npos;
+    }
+
+    const priority_type& priority(id_type id) const {
+        return heap_[pos_[id]].first;
+    }
+
+    id_type top() const {
+        return heap_.front().second;
+    }
+
+    const priority_type& top_priority() const {
+        return heap_.front().first;
+    }
+
+    void push(id_type id, priority_type priority) {
+        heap_.emplace_back(priority, id);
+        sift_up(heap_.size() - 1);
+    }
+
+    void decrease(id_type id, priority_type priority) {
+        std::size_t index = pos_[id];
+        heap_[index].first = priority;
+        sift_up(index);
+    }
+
+    /*!
+     * \brief Добавить id или уменьшить его приоритет
+     * @return true, если приоритет изменился
+     */
+    bool push_or_decrease(id_type id, priority_type priority) {
+        if (!contains(id)) {
+            push(id, priority);
+            return true;
+        }
+
+        if (priority < heap_[pos_[id]].first) {
+            decrease(id, priority);
+            return true;
+        }
+
+        return false;
+    }
+
+    id_type pop() {
+        id_type result = heap_.front().second;
+        pos_[result] = npos;
+
+        auto last = heap_.back();
+        heap_.pop_back();
+        if (!heap_.empty()) {
+            heap_.front() = last;
+            sift_down(0);
+        }
+
+        return result;
+    }
+
+    /*!
+     * \brief Очистка за O(size()), а не за O(capacity())
+     */
+    void clear() {
+        for (const auto& item : heap_) {
+            pos_[item.second] = npos;
+        }
+        heap_.clear();
+    }
+};
@@ -0,0 +1,368 @@
+#pragma once
+
+#include <vector>
+#include <limits>
+#include <cstdint>
+#include <utility>
+#include <algorithm>
+#include <stdexcept>
+#include <type_traits>
+#include "Parallel.h"
+#include "ShortestPathTree.h"
+
+
+/*!
+ * \brief Параллельный delta-stepping: кратчайшие пути от одной вершины до всех
+ *
+ * Вершины распределены между потоками по остатку id; каждый поток владеет
+ * расстояниями, предками и корзинами своих вершин, а релаксации в чужие вершины
+ * отправляет владельцу через почтовые ящики - поэтому атомарных операций нет.
+ * Корзина i хранит вершины с расстоянием в [i * delta, (i + 1) * delta);
+ * лёгкие рёбра (вес <= delta) релаксируются, пока корзина не опустеет,
+ * тяжёлые - один раз после этого. Раунды разделены барьерами.
+ * @tparam csr_t CsrGraph или совместимое представление
+ */
+template<typename csr_t>
+class DeltaSteppingEngine {
+public:
+    typedef typename csr_t::id_type id_type;
+    typedef std::decay_t<decltype(std::declval<const csr_t&>().weight(0))> weight_type;
+
+    static constexpr id_type npos = csr_t::npos;
+
+private:
+    static constexpr std::size_t no_bucket = std::numeric_limits<std::size_t>::max();
+
+    struct Request {
+        id_type to;
+        id_type from;
+        weight_type dist;
+    };
+
+    struct Worker {
+        std::vector<std::vector<id_type>> buckets;
+        std::vector<id_type> frontier;
+        std::vector<id_type> settled;
+        std::vector<std::vector<Request>> outbox;
+        std::size_t next = no_bucket;
+        bool busy = false;
+    };
+
+    const csr_t* graph_;
+    unsigned threads_;
+    weight_type delta_;
+    std::size_t bucket_count_;
+
+    std::vector<weight_type> dist_;
+    std::vector<id_type> parent_;
+    std::vector<char> reached_;
+    std::vector<std::size_t> bucket_of_;
+    std::vector<char> in_settled_;
+    std::vector<Worker> workers_;
+    id_type source_ = npos;
+
+    unsigned owner(id_type id) const {
+        return id % threads_;
+    }
+
+    std::size_t bucket(const weight_type& dist) const {
+        return static_cast<std::size_t>(dist / delta_);
+    }
+
+    void relax(Worker& self, const Request& request) {
+        id_type to = request.to;
+        if (reached_[to] && !(request.dist < dist_[to])) {
+            return;
+        }
+
+        reached_[to] = 1;
+        dist_[to] = request.dist;
+        parent_[to] = request.from;
+
+        std::size_t index = bucket(request.dist);
+        if (bucket_of_[to] != index) {
+            bucket_of_[to] = index;
+            self.buckets[index % bucket_count_].push_back(to);
+        }
+    }
+
+    void send(Worker& self, id_type v, bool light) {
+        const weight_type& dv = dist_[v];
+
+        for (std::size_t e = graph_->edge_begin(v), end = graph_->edge_end(v); e < end; e++) {
+            const weight_type& len = graph_->weight(e);
+            if (!(delta_ < len) == light) {
+                id_type to = graph_->target(e);
+                self.outbox[owner(to)].push_back(Request{to, v, dv + len});
+            }
+        }
+    }
+
+    // все потоки разбирают адресованные им запросы; после второго барьера ящики можно чистить.
+    // false - барьер прерван ошибкой в другом потоке
+    bool exchange(unsigned part, Barrier& barrier) {
+        Worker& self = workers_[part];
+        if (!barrier.wait()) {
+            return false;
+        }
+
+        for (Worker& sender : workers_) {
+            for (const Request& request : sender.outbox[part]) {
+                relax(self, request);
+            }
+        }
+
+        if (!barrier.wait()) {
+            return false;
+        }
+
+        for (auto& box : self.outbox) {
+            box.clear();
+        }
+
+        return true;
+    }
+
+    void work(unsigned part, id_type source, Barrier& barrier) {
+        Worker& self = workers_[part];
+
+        for (std::size_t v = part; v < graph_->size(); v += threads_) {
+            reached_[v] = 0;
+            parent_[v] = npos;
+            bucket_of_[v] = no_bucket;
+            in_settled_[v] = 0;
+        }
+
+        for (auto& slot : self.buckets) {
+            slot.clear();
+        }
+
+        if (owner(source) == part) {
+            relax(self, Request{source, npos, weight_type()});
+        }
+
+        std::size_t current = 0;
+        for (;;) {
+            self.next = no_bucket;
+            for (std::size_t step = 0; step < bucket_count_; step++) {
+                if (!self.buckets[(current + step) % bucket_count_].empty()) {
+                    self.next = current + step;
+                    break;
+                }
+            }
+
+            if (!barrier.wait()) {
+                return;
+            }
+
+            current = no_bucket;
+            for (const Worker& worker : workers_) {
+                current = std::min(current, worker.next);
+            }
+
+            if (current == no_bucket) {
+                break;
+            }
+
+            auto& slot = self.buckets[current % bucket_count_];
+            for (;;) {
+                self.frontier.clear();
+                self.frontier.swap(slot);
+
+                for (id_type v : self.frontier) {
+                    if (bucket_of_[v] != current) {
+                        continue;
+                    }
+
+                    bucket_of_[v] = no_bucket;
+                    if (!in_settled_[v]) {
+                        in_settled_[v] = 1;
+                        self.settled.push_back(v);
+                    }
+
+                    send(self, v, true);
+                }
+
+                if (!exchange(part, barrier)) {
+                    return;
+                }
+
+                self.busy = !slot.empty();
+                if (!barrier.wait()) {
+                    return;
+                }
+
+                bool busy = false;
+                for (const Worker& worker : workers_) {
+                    busy = busy || worker.busy;
+                }
+
+                if (!busy) {
+                    break;
+                }
+            }
+
+            for (id_type v : self.settled) {
+                in_settled_[v] = 0;
+                send(self, v, false);
+            }
+            self.settled.clear();
+
+            if (!exchange(part, barrier)) {
+                return;
+            }
+        }
+    }
+
+public:
+    /*!
+     * \param threads число потоков, 0 - по числу ядер
+     * \param delta ширина корзины; 0 - максимальный вес ребра, делённый на среднюю степень.
+     * Слишком узкая корзина расширяется (удвоением), пока корзин не станет не больше V + 2
+     */
+    explicit DeltaSteppingEngine(const csr_t& graph, unsigned threads = 0, weight_type delta = weight_type())
+            : graph_(&graph), threads_(worker_count(threads, graph.size(), 1024)), delta_(delta) {
+        std::size_t edges = graph.edge_count();
+        unsigned scanners = worker_count(threads, edges);
+        std::vector<weight_type> heaviest(scanners, weight_type());
+        std::vector<char> negative(scanners, 0);
+
+        parallel_for(0, edges, scanners, [&](unsigned part, std::size_t lo, std::size_t hi) {
+            for (std::size_t e = lo; e < hi; e++) {
+                const weight_type& len = graph.weight(e);
+                if (len < 0) {
+                    negative[part] = 1;
+                }
+                if (heaviest[part] < len) {
+                    heaviest[part] = len;
+                }
+            }
+        });
+
+        if (std::find(negative.begin(), negative.end(), 1) != negative.end()) {
+            throw std::logic_error("negative weight.\n");
+        }
+
+        weight_type max_weight = *std::max_element(heaviest.begin(), heaviest.end());
+        if (!(weight_type() < delta_)) {
+            std::size_t degree = std::max<std::size_t>(1, edges / std::max<std::size_t>(1, graph.size()));
+            delta_ = max_weight / static_cast<weight_type>(degree);
+        }
+        if (!(weight_type() < delta_)) {
+            delta_ = weight_type(1);
+        }
+
+        // корзин не больше V + 2, иначе крошечная delta раздует массивы корзин без пользы
+        weight_type most_buckets = static_cast<weight_type>(std::max<std::size_t>(1, graph.size()));
+        while (most_buckets < max_weight / delta_) {
+            delta_ += delta_;
+        }
+
+        // все ожидающие расстояния лежат не дальше max_weight от текущей корзины, так что корзин хватит по кругу
+        bucket_count_ = static_cast<std::size_t>(max_weight / delta_) + 2;
+
+        dist_.assign(graph.size(), weight_type());
+        parent_.assign(graph.size(), npos);
+        reached_.assign(graph.size(), 0);
+        bucket_of_.assign(graph.size(), no_bucket);
+        in_settled_.assign(graph.size(), 0);
+
+        workers_.resize(threads_);
+        for (Worker& worker : workers_) {
+            worker.buckets.resize(bucket_count_);
+            worker.outbox.resize(threads_);
+        }
+    }
+
+    DeltaSteppingEngine(const DeltaSteppingEngine& other) = delete;
+
+    DeltaSteppingEngine& operator=(const DeltaSteppingEngine& rhs) = delete;
+
+    const csr_t& graph() const {
+        return *graph_;
+    }
+
+    unsigned threads() const {
+        return threads_;
+    }
+
+    const weight_type& delta() const {
+        return delta_;
+    }
+
+    /*!
+     * \brief Расстояния от source до всех достижимых вершин
+     */
+    void run(id_type source) {
+        source_ = source;
+
+        // упавший поток прерывает барьер, чтобы остальные не ждали его вечно;
+        // исключение пробрасывает parallel_for после join
+        Barrier barrier(threads_);
+        parallel_for(0, threads_, threads_, [&](unsigned, std::size_t lo, std::size_t) {
+            try {
+                work(static_cast<unsigned>(lo), source, barrier);
+            } catch (...) {
+                barrier.abort();
+                throw;
+            }
+        });
+    }
+
+    bool reached(id_type id) const {
+        return reached_[id];
+    }
+
+    const weight_type& distance(id_type id) const {
+        return dist_[id];
+    }
+
+    id_type parent(id_type id) const {
+        return parent_[id];
+    }
+
+    template<typename route_t>
+    route_t route(id_type target) const {
+        route_t result;
+
+        for (id_type v = target; v != npos; v = parent_[v]) {
+            result.push_back(graph_->key(v));
+        }
+
+        std::reverse(result.begin(), result.end());
+        return result;
+    }
+
+    /*!
+     * \brief Дерево кратчайших путей последнего run()
+     */
+    ShortestPathTree<csr_t> tree() const {
+        std::vector<weight_type> dist(graph_->size(), weight_type());
+        std::vector<id_type> parent(graph_->size(), npos);
+
+        for (id_type v = 0; v < reached_.size(); v++) {
+            if (reached_[v]) {
+                dist[v] = dist_[v];
+                parent[v] = parent_[v];
+            }
+        }
+
+        return ShortestPathTree<csr_t>(*graph_, source_, std::move(dist), std::move(parent));
+    }
+
+    /*!
+     * \brief Кратчайший путь между ключами, как у dijkstra(); поиск при этом идёт до всех вершин
+     */
+    template<typename route_t, typename node_type_t>
+    std::pair<weight_type, route_t> query(const node_type_t& key_from, const node_type_t& key_to) {
+        id_type from = graph_->at(key_from);
+        id_type to = graph_->at(key_to);
+
+        run(from);
+        if (!reached_[to]) {
+            throw std::logic_error("no route.\n");
+        }
+
+        return std::pair<weight_type, route_t>(dist_[to], route<route_t>(to));
+    }
+};
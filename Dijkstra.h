@@ -0,0 +1,380 @@
+#pragma once
+
+#include <vector>
+#include <limits>
+#include <cstdint>
+#include <utility>
+#include <algorithm>
+#include <stdexcept>
+#include <type_traits>
+#include "DaryHeap.h"
+#include "ShortestPathTree.h"
+
+
+/*!
+ * \brief Итог поиска без исключений: для пакетных запросов, где ошибка одного запроса не должна прерывать остальные
+ */
+enum class query_status {
+    ok,
+    no_node,
+    no_route,
+    negative_weight,
+    negative_cycle
+};
+
+
+/*!
+ * \brief Поиск кратчайших путей Дейкстры на куче над CSR-снимком графа
+ *
+ * Состояние (расстояния, предки, куча) переиспользуется между запросами:
+ * сброс делается сменой поколения, а не обнулением массивов. Как и исходный
+ * dijkstra(), поиск отвергает любое отрицательное ребро, достижимое из источника,
+ * даже лежащее дальше цели: если в снимке есть отрицательные веса (это
+ * проверяется один раз), поиск с целью не обрывается на ней.
+ * @tparam csr_t CsrGraph или совместимое представление
+ */
+template<typename csr_t>
+class DijkstraEngine {
+public:
+    typedef typename csr_t::id_type id_type;
+    typedef std::decay_t<decltype(std::declval<const csr_t&>().weight(0))> weight_type;
+
+    static constexpr id_type npos = csr_t::npos;
+
+private:
+    const csr_t* graph_;
+    std::vector<weight_type> dist_;
+    std::vector<id_type> parent_;
+    std::vector<std::uint32_t> stamp_;
+    std::uint32_t current_ = 0;
+    id_type source_ = npos;
+    DaryHeap<weight_type> heap_;
+    bool scanned_ = false;
+    bool negative_ = false;
+
+    void next_generation() {
+        if (dist_.size() != graph_->size()) {
+            dist_.assign(graph_->size(), weight_type());
+            parent_.assign(graph_->size(), npos);
+            stamp_.assign(graph_->size(), 0);
+            heap_.resize(graph_->size());
+            current_ = 0;
+        }
+
+        if (!scanned_) {
+            scanned_ = true;
+            for (std::size_t e = 0; e < graph_->edge_count() && !negative_; e++) {
+                negative_ = graph_->weight(e) < 0;
+            }
+        }
+
+        heap_.clear();
+
+        if (++current_ == 0) {
+            std::fill(stamp_.begin(), stamp_.end(), 0);
+            current_ = 1;
+        }
+    }
+
+public:
+    explicit DijkstraEngine(const csr_t& graph) : graph_(&graph) {}
+
+    const csr_t& graph() const {
+        return *graph_;
+    }
+
+    /*!
+     * \brief Поиск из source; останавливается, как только target окончательно найден
+     * @param target npos - посчитать расстояния до всех достижимых вершин
+     * @return true, если target достижим (для target == npos всегда true)
+     */
+    bool run(id_type source, id_type target = npos) {
+        query_status status = try_run(source, target);
+        if (status == query_status::negative_weight) {
+            throw std::logic_error("negative weight.\n");
+        }
+
+        return status == query_status::ok;
+    }
+
+    /*!
+     * \brief То же, что run(), но отрицательный вес не бросает исключение, а возвращается статусом
+     */
+    query_status try_run(id_type source, id_type target = npos) {
+        next_generation();
+
+        source_ = source;
+        stamp_[source] = current_;
+        dist_[source] = weight_type();
+        parent_[source] = npos;
+        heap_.push(source, weight_type());
+
+        bool found = target == npos;
+        while (!heap_.empty()) {
+            id_type v = heap_.pop();
+            if (v == target) {
+                found = true;
+                if (!negative_) {
+                    return query_status::ok;
+                }
+            }
+
+            weight_type dv = dist_[v];
+            for (std::size_t e = graph_->edge_begin(v), end = graph_->edge_end(v); e < end; e++) {
+                const weight_type& len = graph_->weight(e);
+                if (len < 0) {
+                    return query_status::negative_weight;
+                }
+
+                id_type to = graph_->target(e);
+                weight_type candidate = dv + len;
+
+                if (stamp_[to] != current_) {
+                    stamp_[to] = current_;
+                    dist_[to] = candidate;
+                    parent_[to] = v;
+                    heap_.push(to, candidate);
+                } else if (candidate < dist_[to] && heap_.contains(to)) {
+                    dist_[to] = candidate;
+                    parent_[to] = v;
+                    heap_.decrease(to, candidate);
+                }
+            }
+        }
+
+        return found ? query_status::ok : query_status::no_route;
+    }
+
+    bool reached(id_type id) const {
+        return stamp_[id] == current_;
+    }
+
+    const weight_type& distance(id_type id) const {
+        return dist_[id];
+    }
+
+    id_type parent(id_type id) const {
+        return parent_[id];
+    }
+
+    /*!
+     * \brief Маршрут (ключи вершин) от источника последнего поиска до target
+     */
+    template<typename route_t>
+    route_t route(id_type target) const {
+        route_t result;
+
+        for (id_type v = target; v != npos; v = parent_[v]) {
+            result.push_back(graph_->key(v));
+        }
+
+        std::reverse(result.begin(), result.end());
+        return result;
+    }
+
+    /*!
+     * \brief Кратчайший путь между ключами, как у dijkstra()
+     */
+    template<typename route_t, typename node_type_t>
+    std::pair<weight_type, route_t> query(const node_type_t& key_from, const node_type_t& key_to) {
+        id_type from = graph_->at(key_from);
+        id_type to = graph_->at(key_to);
+
+        if (!run(from, to)) {
+            throw std::logic_error("no route.\n");
+        }
+
+        return std::pair<weight_type, route_t>(dist_[to], route<route_t>(to));
+    }
+
+    /*!
+     * \brief Дерево кратчайших путей последнего поиска; полно, если поиск шёл без цели
+     */
+    ShortestPathTree<csr_t> tree() const {
+        std::vector<weight_type> dist(graph_->size(), weight_type());
+        std::vector<id_type> parent(graph_->size(), npos);
+
+        for (id_type v = 0; v < stamp_.size(); v++) {
+            if (stamp_[v] == current_ && !heap_.contains(v)) {
+                dist[v] = dist_[v];
+                parent[v] = parent_[v];
+            }
+        }
+
+        return ShortestPathTree<csr_t>(*graph_, source_, std::move(dist), std::move(parent));
+    }
+
+    /*!
+     * \brief Полный поиск из вершины key_from и его дерево кратчайших путей
+     */
+    template<typename node_type_t>
+    ShortestPathTree<csr_t> tree(const node_type_t& key_from) {
+        run(graph_->at(key_from));
+        return tree();
+    }
+};
+
+
+/*!
+ * \brief Двунаправленный Дейкстра для запросов "точка-точка"
+ *
+ * Поиск идёт одновременно вперёд от источника по forward и назад от цели по
+ * backward (обычно forward.transpose()) и останавливается, когда сумма
+ * минимумов двух куч не меньше лучшего найденного пути через встречу фронтов.
+ * @tparam csr_t CsrGraph или совместимое представление
+ */
+template<typename csr_t>
+class BidirectionalDijkstraEngine {
+public:
+    typedef typename csr_t::id_type id_type;
+    typedef std::decay_t<decltype(std::declval<const csr_t&>().weight(0))> weight_type;
+
+    static constexpr id_type npos = csr_t::npos;
+
+private:
+    struct Side {
+        const csr_t* graph;
+        std::vector<weight_type> dist;
+        std::vector<id_type> parent;
+        std::vector<std::uint32_t> stamp;
+        DaryHeap<weight_type> heap;
+
+        explicit Side(const csr_t& g) : graph(&g) {}
+    };
+
+    Side forward_;
+    Side backward_;
+    std::uint32_t current_ = 0;
+    id_type meet_ = npos;
+    weight_type best_ = weight_type();
+
+    void next_generation() {
+        for (Side* side : {&forward_, &backward_}) {
+            if (side->dist.size() != side->graph->size()) {
+                side->dist.assign(side->graph->size(), weight_type());
+                side->parent.assign(side->graph->size(), npos);
+                side->stamp.assign(side->graph->size(), 0);
+                side->heap.resize(side->graph->size());
+            }
+            side->heap.clear();
+        }
+
+        if (++current_ == 0) {
+            for (Side* side : {&forward_, &backward_}) {
+                std::fill(side->stamp.begin(), side->stamp.end(), 0);
+            }
+            current_ = 1;
+        }
+    }
+
+    void start(Side& side, id_type id) {
+        side.stamp[id] = current_;
+        side.dist[id] = weight_type();
+        side.parent[id] = npos;
+        side.heap.push(id, weight_type());
+    }
+
+    // один шаг поиска со стороны side; other - встречный поиск
+    void step(Side& side, const Side& other) {
+        id_type v = side.heap.pop();
+        weight_type dv = side.dist[v];
+
+        for (std::size_t e = side.graph->edge_begin(v), end = side.graph->edge_end(v); e < end; e++) {
+            const weight_type& len = side.graph->weight(e);
+            if (len < 0) {
+                throw std::logic_error("negative weight.\n");
+            }
+
+            id_type to = side.graph->target(e);
+            weight_type candidate = dv + len;
+
+            if (side.stamp[to] != current_) {
+                side.stamp[to] = current_;
+                side.dist[to] = candidate;
+                side.parent[to] = v;
+                side.heap.push(to, candidate);
+            } else if (candidate < side.dist[to] && side.heap.contains(to)) {
+                side.dist[to] = candidate;
+                side.parent[to] = v;
+                side.heap.decrease(to, candidate);
+            } else {
+                continue;
+            }
+
+            if (other.stamp[to] == current_) {
+                weight_type through = side.dist[to] + other.dist[to];
+                if (meet_ == npos || through < best_) {
+                    best_ = through;
+                    meet_ = to;
+                }
+            }
+        }
+    }
+
+public:
+    BidirectionalDijkstraEngine(const csr_t& forward, const csr_t& backward) : forward_(forward), backward_(backward) {
+        if (forward.size() != backward.size()) {
+            throw std::logic_error("forward and backward graphs differ.\n");
+        }
+    }
+
+    /*!
+     * \brief Поиск пути source -> target
+     * @return true, если путь есть
+     */
+    bool run(id_type source, id_type target) {
+        next_generation();
+
+        start(forward_, source);
+        start(backward_, target);
+
+        meet_ = source == target ? source : npos;
+        best_ = weight_type();
+
+        while (!forward_.heap.empty() && !backward_.heap.empty()) {
+            if (meet_ != npos && !(forward_.heap.top_priority() + backward_.heap.top_priority() < best_)) {
+                break;
+            }
+
+            if (forward_.heap.size() <= backward_.heap.size()) {
+                step(forward_, backward_);
+            } else {
+                step(backward_, forward_);
+            }
+        }
+
+        return meet_ != npos;
+    }
+
+    const weight_type& distance() const {
+        return best_;
+    }
+
+    template<typename route_t>
+    route_t route() const {
+        route_t result;
+
+        for (id_type v = meet_; v != npos; v = forward_.parent[v]) {
+            result.push_back(forward_.graph->key(v));
+        }
+        std::reverse(result.begin(), result.end());
+
+        for (id_type v = backward_.parent[meet_]; v != npos; v = backward_.parent[v]) {
+            result.push_back(forward_.graph->key(v));
+        }
+
+        return result;
+    }
+
+    template<typename route_t, typename node_type_t>
+    std::pair<weight_type, route_t> query(const node_type_t& key_from, const node_type_t& key_to) {
+        id_type from = forward_.graph->at(key_from);
+        id_type to = forward_.graph->at(key_to);
+
+        if (!run(from, to)) {
+            throw std::logic_error("no route.\n");
+        }
+
+        return std::pair<weight_type, route_t>(best_, route<route_t>());
+    }
+};
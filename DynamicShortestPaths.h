@@ -0,0 +1,328 @@
+#pragma once
+
+#include <map>
+#include <queue>
+#include <vector>
+#include <utility>
+#include <algorithm>
+#include <functional>
+#include <stdexcept>
+#include "Graph.h"
+
+
+/*!
+ * \brief Кратчайшие пути от одной вершины, поддерживаемые при изменении графа
+ *
+ * Подписывается на события графа и чинит только затронутую часть дерева
+ * (в духе Рамалингама - Репса). Уменьшение веса или новое ребро - Дейкстра от
+ * вершины, которой стало короче. Увеличение веса или удаление ребра дерева -
+ * поддерево его конца теряет расстояния, каждая его вершина получает лучшее
+ * предложение от незатронутых входящих соседей (по обратному индексу графа),
+ * и дальше Дейкстра только внутри поддерева. Массовые изменения и
+ * отрицательные веса приводят к полному пересчёту при следующем запросе.
+ * Граф должен пережить объект и не переезжать в памяти.
+ * @tparam key_type
+ * @tparam value_type
+ * @tparam weight_type
+ * @tparam storage_type
+ */
+template<typename key_type, typename value_type, typename weight_type, typename storage_type = map_storage>
+class DynamicShortestPaths {
+public:
+    typedef Graph<key_type, value_type, weight_type, storage_type> graph_type;
+
+private:
+    struct Label {
+        weight_type dist;
+        key_type parent;
+        bool root;
+    };
+
+    typedef std::pair<weight_type, key_type> item_type;
+    typedef std::priority_queue<item_type, std::vector<item_type>, std::greater<item_type>> queue_type;
+
+    graph_type* graph_;
+    key_type source_;
+    std::size_t subscription_;
+
+    std::map<key_type, Label> labels_;
+    bool stale_ = true;
+    std::size_t touched_ = 0;
+
+    const graph_type& graph() const {
+        return *graph_;
+    }
+
+    // Дейкстра от вершин очереди; false - встретился отрицательный вес
+    bool propagate(queue_type& queue) {
+        while (!queue.empty()) {
+            item_type item = queue.top();
+            queue.pop();
+
+            auto it = labels_.find(item.second);
+            if (it == labels_.end() || it->second.dist < item.first) {
+                continue;
+            }
+
+            touched_++;
+            for (const auto& [to, weight] : graph()[item.second]) {
+                if (weight < 0) {
+                    return false;
+                }
+
+                weight_type candidate = item.first + weight;
+                auto target = labels_.find(to);
+
+                if (target == labels_.end()) {
+                    labels_.emplace(to, Label{candidate, item.second, false});
+                    queue.emplace(candidate, to);
+                } else if (candidate < target->second.dist) {
+                    target->second = Label{candidate, item.second, false};
+                    queue.emplace(candidate, to);
+                }
+            }
+        }
+
+        return true;
+    }
+
+    void rebuild() {
+        labels_.clear();
+        stale_ = false;
+        touched_ = 0;
+
+        if (!graph_->contains(source_)) {
+            return;
+        }
+
+        queue_type queue;
+        labels_.emplace(source_, Label{weight_type(), source_, true});
+        queue.emplace(weight_type(), source_);
+
+        if (!propagate(queue)) {
+            stale_ = true;
+        }
+    }
+
+    void decrease(const key_type& from, const key_type& to, const weight_type& candidate) {
+        auto target = labels_.find(to);
+        if (target == labels_.end()) {
+            labels_.emplace(to, Label{candidate, from, false});
+        } else {
+            target->second = Label{candidate, from, false};
+        }
+
+        queue_type queue;
+        queue.emplace(candidate, to);
+
+        if (!propagate(queue)) {
+            stale_ = true;
+        }
+    }
+
+    // вершина key потеряла ребро из дерева или оно стало длиннее
+    void increase(const key_type& key) {
+        if (!graph_->reverse_index()) {
+            stale_ = true;
+            return;
+        }
+
+        std::vector<key_type> affected(1, key);
+        for (std::size_t i = 0; i < affected.size(); i++) {
+            for (const auto& [to, weight] : graph()[affected[i]]) {
+                auto child = labels_.find(to);
+                if (child != labels_.end() && !child->second.root && child->second.parent == affected[i]) {
+                    affected.push_back(to);
+                }
+            }
+        }
+
+        for (const auto& v : affected) {
+            labels_.erase(v);
+        }
+
+        queue_type queue;
+        for (const auto& v : affected) {
+            for (const auto& from : graph()[v].incoming) {
+                auto parent = labels_.find(from);
+                if (parent == labels_.end()) {
+                    continue;
+                }
+
+                const auto& edges = graph()[from].edges;
+                auto edge = edges.find(v);
+                if (edge == edges.end()) {
+                    continue;
+                }
+
+                weight_type candidate = parent->second.dist + edge->second;
+                auto target = labels_.find(v);
+                if (target == labels_.end()) {
+                    labels_.emplace(v, Label{candidate, from, false});
+                } else if (candidate < target->second.dist) {
+                    target->second = Label{candidate, from, false};
+                } else {
+                    continue;
+                }
+                queue.emplace(candidate, v);
+            }
+        }
+
+        if (!propagate(queue)) {
+            stale_ = true;
+        }
+    }
+
+    void on_change(const GraphEvent<key_type, weight_type>& event) {
+        if (stale_) {
+            return;
+        }
+
+        touched_ = 0;
+
+        switch (event.kind) {
+            case graph_change::edge_set: {
+                if (event.weight < 0) {
+                    stale_ = true;
+                    return;
+                }
+
+                auto from = labels_.find(event.from);
+                if (from == labels_.end()) {
+                    return;
+                }
+
+                weight_type candidate = from->second.dist + event.weight;
+                auto to = labels_.find(event.to);
+
+                if (to == labels_.end() || candidate < to->second.dist) {
+                    decrease(event.from, event.to, candidate);
+                } else if (!to->second.root && to->second.parent == event.from && to->second.dist < candidate) {
+                    increase(event.to);
+                }
+                return;
+            }
+
+            case graph_change::edge_erased: {
+                auto to = labels_.find(event.to);
+                if (to != labels_.end() && !to->second.root && to->second.parent == event.from) {
+                    increase(event.to);
+                }
+                return;
+            }
+
+            case graph_change::node_inserted:
+                if (event.from == source_) {
+                    stale_ = true;
+                }
+                return;
+
+            case graph_change::node_erased:
+                if (event.from == source_) {
+                    labels_.clear();
+                } else {
+                    labels_.erase(event.from);
+                }
+                return;
+
+            default:
+                stale_ = true;
+        }
+    }
+
+    void ensure() {
+        if (stale_) {
+            rebuild();
+        }
+
+        if (stale_) {
+            throw std::logic_error("negative weight.\n");
+        }
+    }
+
+public:
+    /*!
+     * \brief Пути от source; у графа включается обратный индекс рёбер
+     */
+    DynamicShortestPaths(graph_type& graph, key_type source) : graph_(&graph), source_(source) {
+        static_cast<const graph_type&>(graph)[source];
+        graph.enable_reverse_index();
+
+        subscription_ = graph.subscribe([this](const GraphEvent<key_type, weight_type>& event) {
+            on_change(event);
+        });
+
+        rebuild();
+    }
+
+    DynamicShortestPaths(const DynamicShortestPaths& other) = delete;
+
+    DynamicShortestPaths& operator=(const DynamicShortestPaths& rhs) = delete;
+
+    ~DynamicShortestPaths() {
+        graph_->unsubscribe(subscription_);
+    }
+
+    const key_type& source() const {
+        return source_;
+    }
+
+    /*!
+     * \brief Сколько вершин пересчитано при последней починке или полном пересчёте
+     */
+    std::size_t touched() const {
+        return touched_;
+    }
+
+    bool reaches(const key_type& key) {
+        ensure();
+        return labels_.count(key) != 0;
+    }
+
+    /*!
+     * \brief Расстояние до вершины; для недостижимой - исключение "no route."
+     */
+    weight_type distance_to(const key_type& key) {
+        graph()[key];
+        ensure();
+
+        auto found = labels_.find(key);
+        if (found == labels_.end()) {
+            throw std::logic_error("no route.\n");
+        }
+
+        return found->second.dist;
+    }
+
+    template<typename route_t>
+    route_t route_to(const key_type& key) {
+        graph()[key];
+        ensure();
+
+        auto found = labels_.find(key);
+        if (found == labels_.end()) {
+            throw std::logic_error("no route.\n");
+        }
+
+        route_t result;
+        for (;;) {
+            result.push_back(found->first);
+            if (found->second.root) {
+                break;
+            }
+            found = labels_.find(found->second.parent);
+        }
+
+        std::reverse(result.begin(), result.end());
+        return result;
+    }
+
+    /*!
+     * \brief Длина и маршрут до цели, как у dijkstra() из source()
+     */
+    template<typename route_t>
+    std::pair<weight_type, route_t> query(const key_type& key) {
+        weight_type distance = distance_to(key);
+        return std::pair<weight_type, route_t>(distance, route_to<route_t>(key));
+    }
+};
@@ -0,0 +1,260 @@
+#pragma once
+
+#include <tuple>
+#include <string>
+#include <vector>
+#include <cstdio>
+#include <cstdint>
+#include <cstring>
+#include <charconv>
+#include <iterator>
+#include <algorithm>
+#include <stdexcept>
+#include <string_view>
+#include <type_traits>
+#include "Parallel.h"
+
+
+/*!
+ * \brief Потоковое чтение текстового списка рёбер "from to [weight]" по строке на ребро
+ *
+ * Файл читается блоками по chunk_size байт; блок обрезается по последнему
+ * переводу строки (хвост переходит в следующий блок) и делится между потоками
+ * тоже по границам строк. Числа разбираются std::from_chars без локалей и
+ * потоков ввода. Пустые строки и строки, начинающиеся с '#' или '%', пропускаются;
+ * без веса у ребра вес 1. Ключи-нечисла строятся из string_view (например, Symbol).
+ * @tparam key_type
+ * @tparam weight_type арифметический тип
+ */
+template<typename key_type, typename weight_type>
+class EdgeListReader {
+    static_assert(std::is_arithmetic<weight_type>::value, "weight type must be arithmetic");
+
+public:
+    typedef std::tuple<key_type, key_type, weight_type> edge_type;
+
+private:
+    struct Part {
+        std::vector<edge_type> edges;
+        std::size_t lines = 0;
+        std::size_t bad_line = 0;
+    };
+
+    std::FILE* file_;
+    unsigned threads_;
+    std::size_t chunk_size_;
+    std::vector<char> buffer_;
+    std::size_t carried_ = 0;
+    std::size_t lines_ = 0;
+    bool eof_ = false;
+    std::vector<Part> parts_;
+
+    static bool blank(char c) {
+        return c == ' ' || c == '\t' || c == '\r';
+    }
+
+    static const char* skip_blanks(const char* it, const char* end) {
+        while (it != end && blank(*it)) {
+            it++;
+        }
+        return it;
+    }
+
+    template<typename value_t>
+    static const char* parse(const char* it, const char* end, value_t& value) {
+        if constexpr (std::is_arithmetic<value_t>::value) {
+            if (it != end && *it == '+') {
+                it++;
+            }
+
+            auto [next, error] = std::from_chars(it, end, value);
+            return error == std::errc() ? next : nullptr;
+        } else {
+            const char* first = it;
+            while (it != end && !blank(*it)) {
+                it++;
+            }
+
+            if (it == first) {
+                return nullptr;
+            }
+
+            value = value_t(std::string_view(first, it - first));
+            return it;
+        }
+    }
+
+    // false - строка не разобралась
+    static bool parse_line(const char* it, const char* end, std::vector<edge_type>& edges) {
+        it = skip_blanks(it, end);
+        if (it == end || *it == '#' || *it == '%') {
+            return true;
+        }
+
+        key_type from{}, to{};
+        weight_type weight = weight_type(1);
+
+        it = parse(it, end, from);
+        if (it == nullptr || it == end || !blank(*it)) {
+            return false;
+        }
+
+        it = parse(skip_blanks(it, end), end, to);
+        if (it == nullptr || (it != end && !blank(*it))) {
+            return false;
+        }
+
+        it = skip_blanks(it, end);
+        if (it != end) {
+            it = parse(it, end, weight);
+            if (it == nullptr || skip_blanks(it, end) != end) {
+                return false;
+            }
+        }
+
+        edges.emplace_back(std::move(from), std::move(to), weight);
+        return true;
+    }
+
+    static void parse_part(const char* begin, const char* end, Part& part) {
+        part.edges.clear();
+        part.lines = 0;
+        part.bad_line = 0;
+
+        while (begin != end) {
+            const char* line_end = static_cast<const char*>(std::memchr(begin, '\n', end - begin));
+            if (line_end == nullptr) {
+                line_end = end;
+            }
+
+            part.lines++;
+            if (!parse_line(begin, line_end, part.edges) && part.bad_line == 0) {
+                part.bad_line = part.lines;
+            }
+
+            begin = line_end == end ? end : line_end + 1;
+        }
+    }
+
+public:
+    /*!
+     * \param threads число потоков разбора, 0 - по числу ядер
+     * \param chunk_size сколько байт читать за раз
+     */
+    explicit EdgeListReader(const std::string& path, unsigned threads = 0, std::size_t chunk_size = 64 << 20)
+            : file_(std::fopen(path.c_str(), "rb")), threads_(worker_count(threads, chunk_size, 1 << 20)),
+              chunk_size_(chunk_size), parts_(threads_) {
+        if (file_ == nullptr) {
+            throw std::runtime_error("cannot open file.\n");
+        }
+    }
+
+    EdgeListReader(const EdgeListReader& other) = delete;
+
+    EdgeListReader& operator=(const EdgeListReader& rhs) = delete;
+
+    ~EdgeListReader() {
+        std::fclose(file_);
+    }
+
+    /*!
+     * \brief Прочитать следующий блок и заменить его рёбрами содержимое edges
+     * @return false, если файл закончился и рёбер больше нет
+     */
+    bool next(std::vector<edge_type>& edges) {
+        edges.clear();
+
+        while (edges.empty()) {
+            if (eof_ && carried_ == 0) {
+                return false;
+            }
+
+            buffer_.resize(carried_ + chunk_size_);
+            std::size_t read = eof_ ? 0 : std::fread(buffer_.data() + carried_, 1, chunk_size_, file_);
+            if (read < chunk_size_) {
+                if (std::ferror(file_)) {
+                    throw std::runtime_error("cannot read file.\n");
+                }
+                eof_ = true;
+            }
+
+            const char* begin = buffer_.data();
+            const char* filled = begin + carried_ + read;
+            const char* end = filled;
+
+            // незаконченная последняя строка ждёт следующего блока
+            if (!eof_) {
+                while (end != begin && end[-1] != '\n') {
+                    end--;
+                }
+
+                if (end == begin) {
+                    carried_ += read;
+                    chunk_size_ *= 2;
+                    continue;
+                }
+            }
+
+            unsigned parts = worker_count(threads_, end - begin, 1 << 20);
+            std::vector<const char*> bounds(parts + 1, end);
+            bounds[0] = begin;
+            for (unsigned part = 1; part < parts; part++) {
+                const char* bound = std::max(bounds[part - 1], begin + (end - begin) * part / parts);
+                while (bound != end && bound[-1] != '\n') {
+                    bound++;
+                }
+                bounds[part] = bound;
+            }
+
+            parallel_for(0, parts, parts, [&](unsigned, std::size_t lo, std::size_t hi) {
+                for (std::size_t part = lo; part < hi; part++) {
+                    parse_part(bounds[part], bounds[part + 1], parts_[part]);
+                }
+            });
+
+            for (unsigned part = 0; part < parts; part++) {
+                if (parts_[part].bad_line != 0) {
+                    throw std::runtime_error("bad edge list line " + std::to_string(lines_ + parts_[part].bad_line) +
+                                             ".\n");
+                }
+                lines_ += parts_[part].lines;
+                edges.insert(edges.end(), std::make_move_iterator(parts_[part].edges.begin()),
+                             std::make_move_iterator(parts_[part].edges.end()));
+            }
+
+            carried_ = filled - end;
+            std::memmove(buffer_.data(), end, carried_);
+        }
+
+        return true;
+    }
+
+    /*!
+     * \brief Сколько строк уже прочитано
+     */
+    std::size_t lines() const {
+        return lines_;
+    }
+};
+
+
+/*!
+ * \brief Все рёбра текстового файла "from to [weight]"
+ * @param threads число потоков разбора, 0 - по числу ядер
+ */
+template<typename key_type, typename weight_type>
+std::vector<std::tuple<key_type, key_type, weight_type>> read_edge_list(const std::string& path,
+                                                                        unsigned threads = 0) {
+    EdgeListReader<key_type, weight_type> reader(path, threads);
+
+    std::vector<std::tuple<key_type, key_type, weight_type>> result, chunk;
+    while (reader.next(chunk)) {
+        if (result.empty()) {
+            result.swap(chunk);
+        } else {
+            result.insert(result.end(), chunk.begin(), chunk.end());
+        }
+    }
+
+    return result;
+}
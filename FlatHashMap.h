@@ -0,0 +1,526 @@
+#pragma once
+
+#include <memory>
+#include <utility>
+#include <tuple>
+#include <limits>
+#include <cstdint>
+#include <cstring>
+#include <iterator>
+#include <stdexcept>
+#include <functional>
+#include <type_traits>
+
+
+/*!
+ * \brief Хеш-таблица с открытой адресацией (Robin Hood) и плоским хранением пар
+ *
+ * Интерфейс повторяет нужное графу подмножество std::map. Элементы лежат прямо
+ * в массиве слотов, поэтому любая вставка (и перестройка таблицы) может
+ * переместить их: итераторы и ссылки после вставки недействительны.
+ * Удаление - обратным сдвигом, без "надгробий".
+ * @tparam key_type
+ * @tparam mapped_type
+ * @tparam hash_type
+ * @tparam equal_type
+ * @tparam allocator_t распределитель слотов; новые элементы создаются через него
+ * (с std::pmr::polymorphic_allocator ресурс передаётся и самим значениям)
+ */
+template<typename key_type, typename mapped_type,
+        typename hash_type = std::hash<key_type>, typename equal_type = std::equal_to<key_type>,
+        typename allocator_t = std::allocator<std::pair<const key_type, mapped_type>>>
+class FlatHashMap {
+public:
+    typedef std::pair<const key_type, mapped_type> value_type;
+    typedef allocator_t allocator_type;
+
+private:
+    typedef std::allocator_traits<allocator_type> traits;
+    typedef typename traits::template rebind_alloc<std::uint8_t> dist_allocator;
+
+    static constexpr std::size_t min_capacity = 8;
+    static constexpr std::uint8_t max_distance = std::numeric_limits<std::uint8_t>::max();
+
+    // dist_[i] == 0 - слот пуст, иначе 1 + расстояние от "идеального" слота
+    std::uint8_t* dist_ = nullptr;
+    value_type* values_ = nullptr;
+    std::size_t capacity_ = 0;
+    std::size_t size_ = 0;
+    unsigned shift_ = 64;
+
+    hash_type hasher_;
+    equal_type equal_;
+    allocator_type alloc_;
+
+    std::size_t ideal(const key_type& key) const {
+        // фибоначчиево хеширование: перемешивает слабые хеши вроде std::hash<int>
+        return static_cast<std::size_t>((static_cast<std::uint64_t>(hasher_(key)) * 0x9E3779B97F4A7C15ull) >> shift_);
+    }
+
+    std::size_t mask() const {
+        return capacity_ - 1;
+    }
+
+    void allocate(std::size_t capacity) {
+        capacity_ = capacity;
+        shift_ = 64;
+        for (std::size_t c = capacity; c > 1; c >>= 1) {
+            shift_--;
+        }
+
+        dist_ = dist_allocator(alloc_).allocate(capacity);
+        std::memset(dist_, 0, capacity);
+        values_ = traits::allocate(alloc_, capacity);
+    }
+
+    void deallocate(std::uint8_t* dist, value_type* values, std::size_t capacity) {
+        traits::deallocate(alloc_, values, capacity);
+        dist_allocator(alloc_).deallocate(dist, capacity);
+    }
+
+    void release() {
+        if (values_ == nullptr) {
+            return;
+        }
+
+        for (std::size_t i = 0; i < capacity_; i++) {
+            if (dist_[i] != 0) {
+                traits::destroy(alloc_, values_ + i);
+            }
+        }
+
+        deallocate(dist_, values_, capacity_);
+
+        values_ = nullptr;
+        dist_ = nullptr;
+        capacity_ = 0;
+        size_ = 0;
+        shift_ = 64;
+    }
+
+    bool lookup(const key_type& key, std::size_t& index) const {
+        if (size_ == 0) {
+            return false;
+        }
+
+        std::size_t i = ideal(key);
+        for (std::uint8_t d = 1; dist_[i] >= d; i = (i + 1) & mask(), d++) {
+            if (dist_[i] == d && equal_(values_[i].first, key)) {
+                index = i;
+                return true;
+            }
+        }
+
+        return false;
+    }
+
+    /*!
+     * \brief Разместить элемент, вытесняя "более богатые" (Robin Hood)
+     * @return слот, куда попал сам элемент; capacity_, если пробирование стало слишком длинным
+     * и таблица была перестроена (тогда элемент всё равно вставлен)
+     */
+    std::size_t place(value_type&& value) {
+        alignas(value_type) unsigned char buffer[2][sizeof(value_type)];
+        value_type* carried = ::new (static_cast<void*>(buffer[0])) value_type(std::move(value));
+        unsigned which = 0;
+
+        std::size_t result = capacity_;
+        std::size_t i = ideal(carried->first);
+        std::uint8_t d = 1;
+
+        for (;;) {
+            if (dist_[i] == 0) {
+                ::new (static_cast<void*>(values_ + i)) value_type(std::move(*carried));
+                carried->~value_type();
+                dist_[i] = d;
+                return result == capacity_ ? i : result;
+            }
+
+            if (dist_[i] < d) {
+                value_type* evicted = ::new (static_cast<void*>(buffer[1 - which])) value_type(std::move(values_[i]));
+                values_[i].~value_type();
+                ::new (static_cast<void*>(values_ + i)) value_type(std::move(*carried));
+                carried->~value_type();
+                carried = evicted;
+                which = 1 - which;
+                std::swap(d, dist_[i]);
+
+                if (result == capacity_) {
+                    result = i;
+                }
+            }
+
+            i = (i + 1) & mask();
+            if (++d == max_distance) {
+                rehash(capacity_ * 2);
+                place(std::move(*carried));
+                carried->~value_type();
+                return capacity_;
+            }
+        }
+    }
+
+    void rehash(std::size_t capacity) {
+        std::uint8_t* old_dist = dist_;
+        value_type* old_values = values_;
+        std::size_t old_capacity = capacity_;
+
+        allocate(capacity);
+
+        for (std::size_t i = 0; i < old_capacity; i++) {
+            if (old_dist[i] != 0) {
+                place(std::move(old_values[i]));
+                old_values[i].~value_type();
+            }
+        }
+
+        if (old_values != nullptr) {
+            deallocate(old_dist, old_values, old_capacity);
+        }
+    }
+
+    void grow_for(std::size_t count) {
+        std::size_t capacity = capacity_ == 0 ? min_capacity : capacity_;
+        // заполненность не больше 7/8
+        while (count * 8 > capacity * 7) {
+            capacity *= 2;
+        }
+
+        if (capacity != capacity_) {
+            rehash(capacity);
+        }
+    }
+
+    void swap_contents(FlatHashMap& other) noexcept {
+        std::swap(dist_, other.dist_);
+        std::swap(values_, other.values_);
+        std::swap(capacity_, other.capacity_);
+        std::swap(size_, other.size_);
+        std::swap(shift_, other.shift_);
+        std::swap(hasher_, other.hasher_);
+        std::swap(equal_, other.equal_);
+    }
+
+    // сам объект пуст; память other можно забрать, только если её выдал такой же распределитель
+    void move_from(FlatHashMap& other) {
+        if (alloc_ == other.alloc_) {
+            swap_contents(other);
+            return;
+        }
+
+        hasher_ = other.hasher_;
+        equal_ = other.equal_;
+        grow_for(other.size_);
+        for (std::size_t i = 0; i < other.capacity_; i++) {
+            if (other.dist_[i] != 0) {
+                try_emplace(other.values_[i].first, std::move(other.values_[i].second));
+            }
+        }
+        other.release();
+    }
+
+    template<bool is_const>
+    class basic_iterator {
+        friend class FlatHashMap;
+
+        template<bool>
+        friend class basic_iterator;
+
+        typedef std::conditional_t<is_const, const FlatHashMap, FlatHashMap> map_t;
+
+        map_t* map_ = nullptr;
+        std::size_t index_ = 0;
+
+        void skip() {
+            while (index_ < map_->capacity_ && map_->dist_[index_] == 0) {
+                index_++;
+            }
+        }
+
+        basic_iterator(map_t* map, std::size_t index) : map_(map), index_(index) {}
+
+    public:
+        typedef std::forward_iterator_tag iterator_category;
+        typedef typename FlatHashMap::value_type value_type;
+        typedef std::ptrdiff_t difference_type;
+        typedef std::conditional_t<is_const, const value_type*, value_type*> pointer;
+        typedef std::conditional_t<is_const, const value_type&, value_type&> reference;
+
+        basic_iterator() = default;
+
+        // неконстантный итератор приводится к константному
+        template<bool other_const, typename = std::enable_if_t<is_const && !other_const>>
+        basic_iterator(const basic_iterator<other_const>& other) : map_(other.map_), index_(other.index_) {}
+
+        reference operator*() const {
+            return map_->values_[index_];
+        }
+
+        pointer operator->() const {
+            return map_->values_ + index_;
+        }
+
+        basic_iterator& operator++() {
+            index_++;
+            skip();
+            return *this;
+        }
+
+        basic_iterator operator++(int) {
+            basic_iterator tmp = *this;
+            ++*this;
+            return tmp;
+        }
+
+        friend bool operator==(const basic_iterator& lhs, const basic_iterator& rhs) {
+            return lhs.index_ == rhs.index_;
+        }
+
+        friend bool operator!=(const basic_iterator& lhs, const basic_iterator& rhs) {
+            return lhs.index_ != rhs.index_;
+        }
+    };
+
+public:
+    typedef basic_iterator<false> iterator;
+    typedef basic_iterator<true> const_iterator;
+
+    FlatHashMap() = default;
+
+    explicit FlatHashMap(const allocator_type& alloc) : alloc_(alloc) {}
+
+    FlatHashMap(const FlatHashMap& other)
+            : FlatHashMap(other, traits::select_on_container_copy_construction(other.alloc_)) {}
+
+    FlatHashMap(const FlatHashMap& other, const allocator_type& alloc)
+            : hasher_(other.hasher_), equal_(other.equal_), alloc_(alloc) {
+        if (other.capacity_ == 0) {
+            return;
+        }
+
+        allocate(other.capacity_);
+        for (std::size_t i = 0; i < capacity_; i++) {
+            if (other.dist_[i] != 0) {
+                traits::construct(alloc_, values_ + i, other.values_[i]);
+                dist_[i] = other.dist_[i];
+                size_++;
+            }
+        }
+    }
+
+    FlatHashMap(FlatHashMap&& other) noexcept : alloc_(other.alloc_) {
+        swap_contents(other);
+    }
+
+    FlatHashMap(FlatHashMap&& other, const allocator_type& alloc) : alloc_(alloc) {
+        move_from(other);
+    }
+
+    FlatHashMap& operator=(const FlatHashMap& rhs) {
+        if (this != &rhs) {
+            FlatHashMap tmp(rhs, traits::propagate_on_container_copy_assignment::value ? rhs.alloc_ : alloc_);
+            *this = std::move(tmp);
+        }
+
+        return *this;
+    }
+
+    FlatHashMap& operator=(FlatHashMap&& rhs) noexcept(traits::propagate_on_container_move_assignment::value ||
+                                                       traits::is_always_equal::value) {
+        if (this != &rhs) {
+            release();
+            if constexpr (traits::propagate_on_container_move_assignment::value) {
+                alloc_ = rhs.alloc_;
+            }
+            move_from(rhs);
+        }
+
+        return *this;
+    }
+
+    ~FlatHashMap() {
+        release();
+    }
+
+    void swap(FlatHashMap& other) noexcept {
+        if constexpr (traits::propagate_on_container_swap::value) {
+            std::swap(alloc_, other.alloc_);
+        }
+        swap_contents(other);
+    }
+
+    allocator_type get_allocator() const {
+        return alloc_;
+    }
+
+    bool empty() const {
+        return size_ == 0;
+    }
+
+    std::size_t size() const {
+        return size_;
+    }
+
+    void clear() {
+        release();
+    }
+
+    void reserve(std::size_t count) {
+        grow_for(count);
+    }
+
+    iterator begin() {
+        iterator it(this, 0);
+        if (capacity_ != 0) {
+            it.skip();
+        }
+        return it;
+    }
+
+    iterator end() {
+        return iterator(this, capacity_);
+    }
+
+    const_iterator begin() const {
+        const_iterator it(this, 0);
+        if (capacity_ != 0) {
+            it.skip();
+        }
+        return it;
+    }
+
+    const_iterator end() const {
+        return const_iterator(this, capacity_);
+    }
+
+    const_iterator cbegin() const {
+        return begin();
+    }
+
+    const_iterator cend() const {
+        return end();
+    }
+
+    iterator find(const key_type& key) {
+        std::size_t index;
+        return lookup(key, index) ? iterator(this, index) : end();
+    }
+
+    const_iterator find(const key_type& key) const {
+        std::size_t index;
+        return lookup(key, index) ? const_iterator(this, index) : end();
+    }
+
+    std::size_t count(const key_type& key) const {
+        std::size_t index;
+        return lookup(key, index) ? 1 : 0;
+    }
+
+    mapped_type& at(const key_type& key) {
+        std::size_t index;
+        if (!lookup(key, index)) {
+            throw std::out_of_range("no such key.\n");
+        }
+
+        return values_[index].second;
+    }
+
+    const mapped_type& at(const key_type& key) const {
+        std::size_t index;
+        if (!lookup(key, index)) {
+            throw std::out_of_range("no such key.\n");
+        }
+
+        return values_[index].second;
+    }
+
+    template<typename... args_t>
+    std::pair<iterator, bool> try_emplace(const key_type& key, args_t&&... args) {
+        std::size_t index;
+        if (lookup(key, index)) {
+            return std::pair<iterator, bool>(iterator(this, index), false);
+        }
+
+        grow_for(size_ + 1);
+
+        // элемент создаётся распределителем, чтобы тот мог передать ему свой ресурс
+        alignas(value_type) unsigned char buffer[sizeof(value_type)];
+        value_type* value = reinterpret_cast<value_type*>(buffer);
+        traits::construct(alloc_, value, std::piecewise_construct, std::forward_as_tuple(key),
+                          std::forward_as_tuple(std::forward<args_t>(args)...));
+        try {
+            index = place(std::move(*value));
+        } catch (...) {
+            traits::destroy(alloc_, value);
+            throw;
+        }
+        traits::destroy(alloc_, value);
+        size_++;
+
+        if (index == capacity_) {
+            lookup(key, index);
+        }
+
+        return std::pair<iterator, bool>(iterator(this, index), true);
+    }
+
+    template<typename value_t>
+    std::pair<iterator, bool> emplace(const key_type& key, value_t&& value) {
+        return try_emplace(key, std::forward<value_t>(value));
+    }
+
+    std::pair<iterator, bool> insert(const value_type& value) {
+        return try_emplace(value.first, value.second);
+    }
+
+    template<typename value_t>
+    std::pair<iterator, bool> insert_or_assign(const key_type& key, value_t&& value) {
+        std::size_t index;
+        if (lookup(key, index)) {
+            values_[index].second = std::forward<value_t>(value);
+            return std::pair<iterator, bool>(iterator(this, index), false);
+        }
+
+        return try_emplace(key, std::forward<value_t>(value));
+    }
+
+    // подсказка позиции для хеш-таблицы бесполезна и игнорируется
+    template<typename... args_t>
+    iterator try_emplace(const_iterator, const key_type& key, args_t&&... args) {
+        return try_emplace(key, std::forward<args_t>(args)...).first;
+    }
+
+    template<typename value_t>
+    iterator insert_or_assign(const_iterator, const key_type& key, value_t&& value) {
+        return insert_or_assign(key, std::forward<value_t>(value)).first;
+    }
+
+    mapped_type& operator[](const key_type& key) {
+        return try_emplace(key).first->second;
+    }
+
+    void erase(const_iterator position) {
+        std::size_t i = position.index_;
+        traits::destroy(alloc_, values_ + i);
+        size_--;
+
+        // обратный сдвиг: подтягиваем хвост кластера на освободившееся место
+        for (std::size_t j = (i + 1) & mask(); dist_[j] > 1; i = j, j = (j + 1) & mask()) {
+            ::new (static_cast<void*>(values_ + i)) value_type(std::move(values_[j]));
+            values_[j].~value_type();
+            dist_[i] = dist_[j] - 1;
+        }
+
+        dist_[i] = 0;
+    }
+
+    std::size_t erase(const key_type& key) {
+        std::size_t index;
+        if (!lookup(key, index)) {
+            return 0;
+        }
+
+        erase(const_iterator(this, index));
+        return 1;
+    }
+};
@@ -1,8 +1,31 @@
 #pragma once
 
 #include <map>
+#include <set>
+#include <tuple>
+#include <vector>
+#include <memory>
 #include <limits>
 #include <algorithm>
+#include <functional>
+#include <memory_resource>
+#include "CsrGraph.h"
+#include "Dijkstra.h"
+#include "AStar.h"
+#include "ContractionHierarchy.h"
+#include "DeltaStepping.h"
+#include "Bfs.h"
+#include "Components.h"
+#include "Dag.h"
+#include "BellmanFord.h"
+#include "Johnson.h"
+#include "BatchQuery.h"
+#include "PathCache.h"
+#include "GraphFile.h"
+#include "EdgeListReader.h"
+#include "StringPool.h"
+#include "Storage.h"
+#include "Parallel.h"
 
 
 using namespace std;
@@ -15,39 +38,171 @@ std::ostream& operator << (std::ostream& out, Point p) {
 }
 
 
+/*!
+ * \brief Что делать с повторяющимися рёбрами и вершинами при массовой загрузке
+ */
+enum class edge_conflict {
+    keep_first, ///< как insert_edge/insert_node: побеждает первое (и уже имеющееся в графе)
+    last_wins   ///< как insert_or_assign_edge/insert_or_assign_node: побеждает последнее
+};
+
+
+/*!
+ * \brief Вид изменения графа для подписчиков (см. Graph::subscribe)
+ */
+enum class graph_change {
+    edge_set,      ///< ребро from -> to добавлено или его вес стал weight
+    edge_erased,   ///< ребра from -> to больше нет
+    node_inserted, ///< появилась вершина from
+    node_erased,   ///< вершины from больше нет (её рёбра уже удалены отдельными событиями)
+    reset          ///< массовое изменение: всё, что известно о графе, надо перечитать
+};
+
+/*!
+ * \brief Событие об изменении графа; приходит после того, как изменение сделано
+ */
+template<typename key_type, typename weight_type>
+struct GraphEvent {
+    graph_change kind;
+    key_type from;
+    key_type to;
+    weight_type weight;
+};
+
+
+template<typename key_type, typename value_type, typename weight_type, typename storage_type>
+class ArenaGraph;
+
+
 /*!
  * \brief Это граф!
  * @tparam key_type
  * @tparam value_type
  * @tparam weight_type
+ * @tparam storage_type политика хранения вершин и рёбер (см. Storage.h)
  */
-template<typename key_type, typename value_type, typename weight_type>
+template<typename key_type, typename value_type, typename weight_type, typename storage_type = map_storage>
 class Graph {
 
+    friend class ArenaGraph<key_type, value_type, weight_type, storage_type>;
+
     /*!
      * \brief Узел (внутренний класс)
+     *
+     * Для pmr-таблиц (см. pmr_storage) узел поддерживает uses-allocator:
+     * таблица вершин передаёт ему свой ресурс, а он - своим рёбрам.
      */
     class Node {
+        friend class Graph;
+
+        Graph* owner = nullptr;
+        key_type self{};
+
+        bool indexed() const {
+            return owner != nullptr && owner->reverse_indexed;
+        }
+
+        // изменение узла, привязанного к графу, - новое поколение графа
+        void touch() {
+            if (owner != nullptr) {
+                owner->generation_++;
+            }
+        }
+
+        void notify(graph_change kind, const key_type& key = key_type(), const weight_type& weight = weight_type()) {
+            if (owner != nullptr) {
+                owner->notify(kind, self, key, weight);
+            }
+        }
+
+        void unlink_all() {
+            if (indexed()) {
+                for (auto& [key, weight] : edges) {
+                    owner->unlink(self, key);
+                }
+            }
+        }
+
+        void link_all() {
+            if (indexed()) {
+                for (auto& [key, weight] : edges) {
+                    owner->link(self, key);
+                }
+            }
+        }
+
     public:
         value_type val;
 
-        map<key_type, weight_type> edges;
+        typedef std::pmr::polymorphic_allocator<std::byte> allocator_type;
+
+        typename storage_type::template edge_table<key_type, weight_type> edges;
+
+        /*!
+         * \brief Ключи вершин, из которых есть ребро в эту (ведётся при включённом обратном индексе)
+         */
+        conditional_t<uses_allocator<decltype(edges), allocator_type>::value, std::pmr::set<key_type>, set<key_type>>
+                incoming;
 
         Node() = default;
 
-        Node(const Node& other) = default;
+        explicit Node(const allocator_type& alloc) : edges(alloc), incoming(alloc) {}
+
+        // копия узла не привязана ни к какому графу
+        Node(const Node& other) : self(other.self), val(other.val), edges(other.edges), incoming(other.incoming) {}
 
+        Node(const Node& other, const allocator_type& alloc)
+                : self(other.self), val(other.val), edges(other.edges, alloc), incoming(other.incoming, alloc) {}
+
+        // перемещение сохраняет привязку: так узел переезжает внутри таблицы графа
         Node(Node&& other) noexcept = default;
 
+        Node(Node&& other, const allocator_type& alloc)
+                : owner(other.owner), self(std::move(other.self)), val(std::move(other.val)),
+                  edges(std::move(other.edges), alloc), incoming(std::move(other.incoming), alloc) {}
+
         explicit Node(const Point& point) {
             val = point;
         }
 
-        Node& operator=(const Node& rhs) = default;
+        Node& operator=(const Node& rhs) {
+            if (this == &rhs) {
+                return *this;
+            }
+
+            touch();
+            unlink_all();
+            val = rhs.val;
+            edges = rhs.edges;
+            if (owner == nullptr) {
+                incoming = rhs.incoming;
+            }
+            link_all();
+            notify(graph_change::reset);
+
+            return *this;
+        }
+
+        Node& operator=(Node&& rhs) noexcept {
+            if (this == &rhs) {
+                return *this;
+            }
+
+            touch();
+            unlink_all();
+            val = std::move(rhs.val);
+            edges = std::move(rhs.edges);
+            if (owner == nullptr) {
+                incoming = std::move(rhs.incoming);
+            }
+            link_all();
+            notify(graph_change::reset);
 
-        Node& operator=(Node&& rhs) noexcept = default;
+            return *this;
+        }
 
         Node& operator=(const Point& point) {
+            touch();
             val = point;
             return *this;
         }
@@ -60,6 +215,7 @@ class Graph {
             return edges.size();
         }
 
+        // чтение значения через неконстантный узел поколение не меняет
         value_type& value() {
             return val;
         }
@@ -69,13 +225,31 @@ class Graph {
         }
 
         void clear() {
+            touch();
+            unlink_all();
+
+            if (owner == nullptr || !owner->observed()) {
+                edges.clear();
+                return;
+            }
+
+            vector<key_type> erased;
+            for (auto& [key, weight] : edges) {
+                erased.push_back(key);
+            }
+
             edges.clear();
+            for (const auto& key : erased) {
+                notify(graph_change::edge_erased, key);
+            }
         }
 
-        typedef typename std::map<key_type, weight_type>::iterator iterator;
-        typedef typename std::map<key_type, weight_type>::const_iterator const_iterator;
+        typedef typename decltype(edges)::iterator iterator;
+        typedef typename decltype(edges)::const_iterator const_iterator;
 
+        // через неконстантные итераторы можно менять веса
         iterator begin() {
+            touch();
             return edges.begin();
         }
 
@@ -100,11 +274,27 @@ class Graph {
         }
 
         pair<iterator, bool> insert_edge(key_type key, weight_type weight) {
-            return edges.insert(pair<key_type, weight_type>(key, weight));
+            touch();
+            auto result = edges.insert(pair<key_type, weight_type>(key, weight));
+            if (result.second && indexed()) {
+                owner->link(self, key);
+            }
+            if (result.second) {
+                notify(graph_change::edge_set, key, weight);
+            }
+
+            return result;
         }
 
         pair<iterator, bool> insert_or_assign_edge(key_type key, weight_type weight) {
-            return edges.insert_or_assign(key, weight);
+            touch();
+            auto result = edges.insert_or_assign(key, weight);
+            if (result.second && indexed()) {
+                owner->link(self, key);
+            }
+            notify(graph_change::edge_set, key, weight);
+
+            return result;
         }
 
 
@@ -113,25 +303,229 @@ class Graph {
                 return false;
             }
 
+            touch();
             edges.erase(key);
+            if (indexed()) {
+                owner->unlink(self, key);
+            }
+            notify(graph_change::edge_erased, key);
+
             return true;
         }
 
     };
 
-    map<key_type, Node> graph;
+    typename storage_type::template node_table<key_type, Node> graph;
+
+    bool reverse_indexed = false;
+
+    size_t generation_ = 0;
+
+    // подписчики не копируются и не переезжают вместе с графом
+    vector<pair<size_t, function<void(const GraphEvent<key_type, weight_type>&)>>> observers_;
+    size_t next_observer_ = 0;
+
+    bool observed() const {
+        return !observers_.empty();
+    }
+
+    void notify(graph_change kind, const key_type& from, const key_type& to = key_type(),
+                const weight_type& weight = weight_type()) {
+        if (observers_.empty()) {
+            return;
+        }
+
+        GraphEvent<key_type, weight_type> event{kind, from, to, weight};
+        for (auto& [id, observer] : observers_) {
+            observer(event);
+        }
+    }
+
+    void link(const key_type& key_from, const key_type& key_to) {
+        auto it = graph.find(key_to);
+        if (it != graph.end()) {
+            it->second.incoming.insert(key_from);
+        }
+    }
+
+    void unlink(const key_type& key_from, const key_type& key_to) {
+        auto it = graph.find(key_to);
+        if (it != graph.end()) {
+            it->second.incoming.erase(key_from);
+        }
+    }
+
+    // удалить все рёбра, ведущие в key
+    void unlink_incoming(const key_type& key) {
+        vector<key_type> erased;
+
+        if (!reverse_indexed) {
+            for (auto& [node_key, node] : graph) {
+                if (node.edges.erase(key) != 0 && observed()) {
+                    erased.push_back(node_key);
+                }
+            }
+        } else {
+            auto& incoming = graph.find(key)->second.incoming;
+            for (const auto& key_from : incoming) {
+                graph.find(key_from)->second.edges.erase(key);
+            }
+            if (observed()) {
+                erased.assign(incoming.begin(), incoming.end());
+            }
+            incoming.clear();
+        }
+
+        for (const auto& key_from : erased) {
+            notify(graph_change::edge_erased, key_from, key);
+        }
+    }
+
+    // один проход по всем рёбрам графа на месте: удалить те, для которых pred(from, to, weight)
+    template<typename predicate_t>
+    size_t erase_edges_where(predicate_t pred) {
+        size_t result = 0;
+        vector<key_type> erased;
+
+        for (auto& [node_key, node] : graph) {
+            erased.clear();
+            for (const auto& [key, weight] : node.edges) {
+                if (pred(node_key, key, weight)) {
+                    erased.push_back(key);
+                }
+            }
+
+            for (const auto& key : erased) {
+                node.edges.erase(key);
+                if (reverse_indexed) {
+                    unlink(node_key, key);
+                }
+            }
+            result += erased.size();
+        }
+
+        return result;
+    }
+
+    // удалить все рёбра, ведущие в вершины из отсортированного списка targets
+    size_t erase_edges_into(const vector<key_type>& targets) {
+        if (!reverse_indexed) {
+            return erase_edges_where([&](const key_type&, const key_type& key, const weight_type&) {
+                return binary_search(targets.begin(), targets.end(), key);
+            });
+        }
+
+        size_t result = 0;
+        for (const auto& key : targets) {
+            auto found = graph.find(key);
+            if (found == graph.end()) {
+                continue;
+            }
+
+            for (const auto& key_from : found->second.incoming) {
+                result += graph.find(key_from)->second.edges.erase(key);
+            }
+            graph.find(key)->second.incoming.clear();
+        }
+
+        return result;
+    }
+
+    template<typename key_range_t>
+    static vector<key_type> sorted_keys(const key_range_t& keys) {
+        vector<key_type> result(std::begin(keys), std::end(keys));
+        sort(result.begin(), result.end());
+        result.erase(unique(result.begin(), result.end(), [](const key_type& lhs, const key_type& rhs) {
+            return !(lhs < rhs) && !(rhs < lhs);
+        }), result.end());
+
+        return result;
+    }
+
+    // устойчивая сортировка и схлопывание повторов: остаётся первый или последний из равных
+    template<typename item_t, typename less_t, typename equal_t>
+    static void sort_unique(vector<item_t>& items, less_t less, equal_t same, bool last_wins, unsigned threads) {
+        parallel_stable_sort(items.begin(), items.end(), less, threads);
+
+        size_t out = 0;
+        for (size_t i = 0, j; i < items.size(); i = j) {
+            for (j = i + 1; j < items.size() && same(items[i], items[j]); j++) {}
+
+            size_t chosen = last_wins ? j - 1 : i;
+            if (out != chosen) {
+                items[out] = std::move(items[chosen]);
+            }
+            out++;
+        }
+
+        items.erase(items.begin() + out, items.end());
+    }
+
+    template<typename iterator_t>
+    iterator_t attach(iterator_t it) {
+        it->second.owner = this;
+        it->second.self = it->first;
+        return it;
+    }
+
+    void rebind() {
+        for (auto& [key, node] : graph) {
+            node.owner = this;
+        }
+    }
 
 public:
 
     Graph() = default;
 
-    Graph(const Graph& other) = default;
+    /*!
+     * \brief Пустой граф, берущий память у resource (только для pmr-политик хранения)
+     */
+    explicit Graph(std::pmr::memory_resource* resource)
+            : graph(typename decltype(graph)::allocator_type(resource)) {}
+
+    // копия берёт память у ресурса по умолчанию, а не у ресурса other
+    Graph(const Graph& other) : graph(other.graph), reverse_indexed(other.reverse_indexed) {
+        rebind();
+    }
+
+    Graph(const Graph& other, std::pmr::memory_resource* resource)
+            : graph(other.graph, typename decltype(graph)::allocator_type(resource)),
+              reverse_indexed(other.reverse_indexed) {
+        rebind();
+    }
+
+    Graph(Graph&& other) noexcept : graph(std::move(other.graph)), reverse_indexed(other.reverse_indexed) {
+        rebind();
+    }
+
+    Graph& operator=(const Graph& rhs) {
+        if (this != &rhs) {
+            Graph tmp(rhs);
+            generation_++;
+            // при разных ресурсах памяти перемещение поэлементное, обмен таблиц был бы неверен
+            graph = std::move(tmp.graph);
+            reverse_indexed = tmp.reverse_indexed;
+            rebind();
+            notify(graph_change::reset, key_type());
+        }
 
-    Graph(Graph&& other) noexcept = default;
+        return *this;
+    }
 
-    Graph& operator=(const Graph& rhs) = default;
+    Graph& operator=(Graph&& rhs) noexcept {
+        if (this != &rhs) {
+            generation_++;
+            rhs.generation_++;
+            graph = std::move(rhs.graph);
+            reverse_indexed = rhs.reverse_indexed;
+            rebind();
+            notify(graph_change::reset, key_type());
+            rhs.notify(graph_change::reset, key_type());
+        }
 
-    Graph& operator=(Graph&& rhs) noexcept = default;
+        return *this;
+    }
 
     /*!
      * \brief Итератор begin()
@@ -146,25 +540,28 @@ public:
     }
 
     void clear() {
+        generation_++;
         graph.clear();
+        notify(graph_change::reset, key_type());
     }
 
-    void swap(Graph<key_type, value_type, weight_type>& other) {
-        Graph<key_type, value_type, weight_type> tmp = other;
+    void swap(Graph& other) {
+        Graph tmp = other;
         other = *this;
         *this = tmp;
     }
 
-    friend void swap(Graph<key_type, value_type, weight_type>& first, Graph& second) {
-        Graph<key_type, value_type, weight_type> tmp;
+    friend void swap(Graph& first, Graph& second) {
+        Graph tmp;
         tmp = first;
         first = second;
         second = tmp;
     }
 
-    typedef typename map<key_type, Node>::iterator iterator;
-    typedef typename map<key_type, Node>::const_iterator const_iterator;
+    typedef typename decltype(graph)::iterator iterator;
+    typedef typename decltype(graph)::const_iterator const_iterator;
 
+    // через неконстантные итераторы можно менять узлы; изменения учтут сами узлы
     iterator begin() {
         return graph.begin();
     }
@@ -190,10 +587,15 @@ public:
     }
 
     size_t degree_in(key_type key) {
-        if (graph.find(key) == graph.end()) {
+        auto found = graph.find(key);
+        if (found == graph.end()) {
             throw std::logic_error("no node with this key in the graph.");
         }
 
+        if (reverse_indexed) {
+            return found->second.incoming.size();
+        }
+
         size_t result = 0;
 
         for (auto& [node_key, node] : graph) {
@@ -227,7 +629,10 @@ public:
 
     Node& operator[](key_type key) {
         if (graph.find(key) == graph.end()) {
-            return graph[key] = Node();
+            generation_++;
+            auto& node = attach(graph.emplace(key, Node()).first)->second;
+            notify(graph_change::node_inserted, key);
+            return node;
         }
 
         return graph[key];
@@ -241,6 +646,10 @@ public:
         return graph.at(key);
     }
 
+    bool contains(key_type key) const {
+        return graph.find(key) != graph.end();
+    }
+
     Node& at(key_type key) {
         if (graph.find(key) == graph.end()) {
             throw logic_error("no such node.\n");
@@ -254,22 +663,31 @@ public:
             return pair<iterator, bool>(graph.find(key), false);
         }
 
+        generation_++;
         Node tmp;
         tmp.value() = val;
 
-        return graph.insert(pair<key_type, Node>(key, tmp));
+        auto [it, flag] = graph.insert(pair<key_type, Node>(key, tmp));
+        attach(it);
+        notify(graph_change::node_inserted, key);
+        return pair<iterator, bool>(it, flag);
     }
 
     pair<iterator, bool> insert_or_assign_node(key_type key, value_type val) {
         if (graph.find(key) != graph.end()) {
-            graph[key].value() = val;
+            generation_++;
+            graph[key].val = val;
             return pair<iterator, bool>(graph.find(key), false);
         }
 
+        generation_++;
         Node tmp;
         tmp.value() = val;
 
-        return graph.insert(pair<key_type, Node>(key, tmp));
+        auto [it, flag] = graph.insert(pair<key_type, Node>(key, tmp));
+        attach(it);
+        notify(graph_change::node_inserted, key);
+        return pair<iterator, bool>(it, flag);
     }
 
     pair<iterator, bool> insert_edge(pair<key_type, key_type> keys, weight_type weight) {
@@ -283,6 +701,7 @@ public:
             throw logic_error("second node is absent\n");
         }
 
+        generation_++;
         auto [it, flag] = graph[key_from].insert_edge(key_to, weight);
 
         return pair<iterator, bool>(graph.find(key_from), flag);
@@ -299,16 +718,150 @@ public:
             throw logic_error("second node is absent\n");
         }
 
+        generation_++;
         auto [it, flag] = graph[key_from].insert_or_assign_edge(key_to, weight);
 
         return pair<iterator, bool>(graph.find(key_from), flag);
     }
 
+    /*!
+     * \brief Массовая загрузка вершин и рёбер
+     *
+     * Повторы отбрасываются после параллельной устойчивой сортировки, затем смежность
+     * каждой вершины строится за один проход по её отсортированным рёбрам (без
+     * поиска вершины на каждое ребро). Если конец какого-то ребра не найден ни в
+     * графе, ни среди nodes, бросается исключение и граф не меняется. Для
+     * pmr-хранения рёбра вставляются в один поток: memory_resource графа (например,
+     * арена ArenaGraph) не обязан выдерживать одновременные allocate().
+     * @param nodes диапазон пар (ключ, значение)
+     * @param edges диапазон троек (откуда, куда, вес)
+     * @param policy как разрешать повторы
+     * @param threads число потоков, 0 - по числу ядер
+     * @return сколько рёбер добавлено
+     */
+    template<typename node_range_t, typename edge_range_t>
+    size_t bulk_insert(const node_range_t& nodes, const edge_range_t& edges,
+                       edge_conflict policy = edge_conflict::keep_first, unsigned threads = 0) {
+        bool last_wins = policy == edge_conflict::last_wins;
+
+        vector<pair<key_type, value_type>> node_list;
+        for (const auto& [key, val] : nodes) {
+            node_list.emplace_back(key, val);
+        }
+
+        sort_unique(node_list,
+                    [](const auto& lhs, const auto& rhs) { return lhs.first < rhs.first; },
+                    [](const auto& lhs, const auto& rhs) { return !(lhs.first < rhs.first); },
+                    last_wins, threads);
+
+        vector<tuple<key_type, key_type, weight_type>> edge_list;
+        for (const auto& [key_from, key_to, weight] : edges) {
+            edge_list.emplace_back(key_from, key_to, weight);
+        }
+
+        sort_unique(edge_list,
+                    [](const auto& lhs, const auto& rhs) {
+                        if (get<0>(lhs) < get<0>(rhs)) return true;
+                        if (get<0>(rhs) < get<0>(lhs)) return false;
+                        return get<1>(lhs) < get<1>(rhs);
+                    },
+                    [](const auto& lhs, const auto& rhs) {
+                        return !(get<0>(lhs) < get<0>(rhs)) && !(get<1>(lhs) < get<1>(rhs));
+                    },
+                    last_wins, threads);
+
+        auto exists = [&](const key_type& key) {
+            if (graph.find(key) != graph.end()) {
+                return true;
+            }
+
+            auto it = lower_bound(node_list.begin(), node_list.end(), key,
+                                  [](const auto& item, const key_type& k) { return item.first < k; });
+            return it != node_list.end() && !(key < it->first);
+        };
+
+        unsigned workers = worker_count(threads, edge_list.size());
+        parallel_for(0, edge_list.size(), workers, [&](unsigned, size_t lo, size_t hi) {
+            for (size_t e = lo; e < hi; e++) {
+                if ((e == lo || get<0>(edge_list[e - 1]) < get<0>(edge_list[e])) && !exists(get<0>(edge_list[e]))) {
+                    throw logic_error("first node is absent\n");
+                }
+                if (!exists(get<1>(edge_list[e]))) {
+                    throw logic_error("second node is absent\n");
+                }
+            }
+        });
+
+        generation_++;
+        for (auto& [key, val] : node_list) {
+            size_t before = graph.size();
+            auto it = graph.try_emplace(graph.end(), key);
+
+            if (graph.size() != before) {
+                attach(it)->second.val = std::move(val);
+            } else if (last_wins) {
+                it->second.val = std::move(val);
+            }
+        }
+
+        // рёбра одной вершины идут подряд: по одному поиску вершины на отрезок
+        vector<size_t> runs;
+        for (size_t e = 0; e < edge_list.size(); e++) {
+            if (e == 0 || get<0>(edge_list[e - 1]) < get<0>(edge_list[e])) {
+                runs.push_back(e);
+            }
+        }
+        runs.push_back(edge_list.size());
+
+        vector<char> inserted(edge_list.size(), 0);
+
+        typedef typename storage_type::template edge_table<key_type, weight_type> edge_table;
+        unsigned builders = uses_allocator<edge_table, std::pmr::polymorphic_allocator<std::byte>>::value
+                            ? 1u : worker_count(threads, edge_list.size());
+
+        parallel_for(0, runs.size() - 1, builders, [&](unsigned, size_t lo, size_t hi) {
+            for (size_t run = lo; run < hi; run++) {
+                auto& node_edges = graph.find(get<0>(edge_list[runs[run]]))->second.edges;
+
+                for (size_t e = runs[run]; e < runs[run + 1]; e++) {
+                    auto& [key_from, key_to, weight] = edge_list[e];
+                    size_t before = node_edges.size();
+
+                    if (last_wins) {
+                        node_edges.insert_or_assign(node_edges.end(), key_to, weight);
+                    } else {
+                        node_edges.try_emplace(node_edges.end(), key_to, weight);
+                    }
+
+                    inserted[e] = node_edges.size() != before;
+                }
+            }
+        });
+
+        size_t result = 0;
+        for (size_t e = 0; e < edge_list.size(); e++) {
+            if (inserted[e]) {
+                result++;
+                if (reverse_indexed) {
+                    link(get<0>(edge_list[e]), get<1>(edge_list[e]));
+                }
+            }
+        }
+
+        notify(graph_change::reset, key_type());
+
+        return result;
+    }
+
 
     void clear_edges() {
-        for (auto [node_key, node] : graph) {
-            node.clear();
+        generation_++;
+        for (auto& [node_key, node] : graph) {
+            node.edges.clear();
+            node.incoming.clear();
         }
+
+        notify(graph_change::reset, key_type());
     }
 
     bool erase_edges_go_from(key_type key) {
@@ -325,86 +878,568 @@ public:
             return false;
         }
 
-        for (auto [node_key, node] : graph) {
-            node.erase_edge(key);
-        }
-
+        generation_++;
+        unlink_incoming(key);
         return true;
     }
 
     bool erase_node(key_type key) {
-        if (graph.find(key) == graph.end()) {
+        auto found = graph.find(key);
+        if (found == graph.end()) {
             return false;
         }
 
-        for (auto [node_key, node] : graph) {
-            node.erase_edge(key);
-        }
+        generation_++;
+        unlink_incoming(key);
+        found->second.clear();
 
-        graph.erase(key);
+        graph.erase(found);
+        notify(graph_change::node_erased, key);
         return true;
     }
+
+    /*!
+     * \brief Удалить рёбра, для которых pred(from, to, weight) истинно, за один проход на месте
+     *
+     * Подписчики получают одно событие graph_change::reset, если что-то удалено.
+     * @return сколько рёбер удалено
+     */
+    template<typename predicate_t>
+    size_t erase_edges_if(predicate_t pred) {
+        size_t result = erase_edges_where(pred);
+        if (result != 0) {
+            generation_++;
+            notify(graph_change::reset, key_type());
+        }
+
+        return result;
+    }
+
+    /*!
+     * \brief Удалить все рёбра, ведущие в вершины из keys: один проход по графу
+     * (с обратным индексом - только по входящим рёбрам этих вершин)
+     * @return сколько рёбер удалено
+     */
+    template<typename key_range_t>
+    size_t erase_edges_go_to_any(const key_range_t& keys) {
+        size_t result = erase_edges_into(sorted_keys(keys));
+        if (result != 0) {
+            generation_++;
+            notify(graph_change::reset, key_type());
+        }
+
+        return result;
+    }
+
+    /*!
+     * \brief Удалить вершины из keys вместе со всеми их рёбрами
+     *
+     * Входящие рёбра удаляются за один проход по графу (или по обратному индексу),
+     * а не отдельным проходом на каждую вершину. Отсутствующие ключи пропускаются.
+     * @return сколько вершин удалено
+     */
+    template<typename key_range_t>
+    size_t erase_nodes(const key_range_t& keys) {
+        vector<key_type> victims = sorted_keys(keys);
+        victims.erase(remove_if(victims.begin(), victims.end(), [this](const key_type& key) {
+            return graph.find(key) == graph.end();
+        }), victims.end());
+
+        if (victims.empty()) {
+            return 0;
+        }
+
+        generation_++;
+        erase_edges_into(victims);
+
+        for (const auto& key : victims) {
+            auto found = graph.find(key);
+            found->second.unlink_all();
+            graph.erase(found);
+        }
+
+        notify(graph_change::reset, key_type());
+        return victims.size();
+    }
+
+    /*!
+     * \brief Включить обратный индекс рёбер: degree_in, erase_edges_go_to и erase_node
+     * будут работать за время, пропорциональное числу входящих рёбер вершины
+     */
+    void enable_reverse_index() {
+        if (reverse_indexed) {
+            return;
+        }
+
+        for (auto& [node_key, node] : graph) {
+            node.incoming.clear();
+        }
+
+        reverse_indexed = true;
+        for (auto& [node_key, node] : graph) {
+            node.link_all();
+        }
+    }
+
+    void disable_reverse_index() {
+        reverse_indexed = false;
+        for (auto& [node_key, node] : graph) {
+            node.incoming.clear();
+        }
+    }
+
+    bool reverse_index() const {
+        return reverse_indexed;
+    }
+
+    /*!
+     * \brief Счётчик изменений: растёт при вставке и удалении вершин и рёбер, присваивании узлов и
+     * значений (insert_or_assign_node, node = point) и при обходе рёбер узла неконстантными итераторами,
+     * через которые можно менять веса. Поиск вершины (operator[], at()) и правка значения по ссылке
+     * из value() его не меняют; прямые записи в открытые поля val и edges не отслеживаются
+     */
+    size_t generation() const {
+        return generation_;
+    }
+
+    /*!
+     * \brief Подписаться на изменения графа
+     *
+     * observer вызывается синхронно после каждого изменения и сам менять граф не
+     * должен. Изменения напрямую через поле edges узла или через итераторы
+     * рёбер не сообщаются.
+     * @return id подписки для unsubscribe()
+     */
+    size_t subscribe(function<void(const GraphEvent<key_type, weight_type>&)> observer) {
+        observers_.emplace_back(next_observer_, std::move(observer));
+        return next_observer_++;
+    }
+
+    void unsubscribe(size_t id) {
+        observers_.erase(remove_if(observers_.begin(), observers_.end(),
+                                   [id](const auto& item) { return item.first == id; }),
+                         observers_.end());
+    }
+
+    /*!
+     * \brief Неизменяемый CSR-снимок графа для алгоритмов обхода
+     * @return CsrGraph
+     */
+    CsrGraph<key_type, value_type, weight_type> freeze() const {
+        return CsrGraph<key_type, value_type, weight_type>(*this);
+    }
 };
 
+/*!
+ * \brief Записать граф в бинарный файл; открывается без разбора через MappedGraph
+ * (для ключей std::string и Symbol - через MappedGraph<std::string_view, ...>)
+ */
+template<typename key_type, typename value_type, typename weight_type, typename storage_type>
+void write_graph_file(const Graph<key_type, value_type, weight_type, storage_type>& graph, const string& path) {
+    write_graph_file(graph.freeze(), path);
+}
+
+/*!
+ * \brief Дописать в граф рёбра из текстового файла "from to [weight]"
+ *
+ * Файл читается блоками, каждый блок разбирается параллельно и целиком уходит в
+ * bulk_insert(). Недостающие вершины создаются со значением value_type(),
+ * значения уже имеющихся не меняются.
+ * @param policy как разрешать повторы рёбер
+ * @param threads число потоков, 0 - по числу ядер
+ * @return сколько рёбер добавлено
+ */
+template<typename key_type, typename value_type, typename weight_type, typename storage_type>
+size_t load_edge_list(Graph<key_type, value_type, weight_type, storage_type>& graph, const string& path,
+                      edge_conflict policy = edge_conflict::keep_first, unsigned threads = 0) {
+    EdgeListReader<key_type, weight_type> reader(path, threads);
+
+    size_t result = 0;
+    vector<tuple<key_type, key_type, weight_type>> edges;
+    vector<pair<key_type, value_type>> nodes;
+
+    while (reader.next(edges)) {
+        nodes.clear();
+        for (const auto& [key_from, key_to, weight] : edges) {
+            for (const key_type* key : {&key_from, &key_to}) {
+                if (!graph.contains(*key)) {
+                    nodes.emplace_back(*key, value_type());
+                }
+            }
+        }
+
+        result += graph.bulk_insert(nodes, edges, policy, threads);
+    }
+
+    return result;
+}
+
+/*!
+ * \brief Кратчайший путь между двумя вершинами (Дейкстра на d-арной куче)
+ *
+ * Каждый вызов строит CSR-снимок графа; для серии запросов выгоднее один раз
+ * вызвать freeze() и пользоваться DijkstraEngine напрямую. Отрицательное ребро,
+ * достижимое из key_from, - исключение "negative weight.", даже если оно дальше key_to.
+ * @return пара (длина пути, маршрут из ключей)
+ */
 template<typename weight_t, typename route_t, typename graph_t, typename node_type_t>
 pair<weight_t, route_t> dijkstra(const graph_t& graph, node_type_t key_from, node_type_t key_to) {
     graph[key_from];
     graph[key_to];
 
-    map<node_type_t, weight_t> d;
-    map<node_type_t, bool> u;
+    const auto frozen = graph.freeze();
+    DijkstraEngine<decay_t<decltype(frozen)>> engine(frozen);
+
+    auto [distance, route] = engine.template query<route_t>(key_from, key_to);
+
+    return pair<weight_t, route_t>(distance, route);
+}
+
+/*!
+ * \brief Дерево кратчайших путей из key_from до всех достижимых вершин
+ *
+ * Дерево владеет CSR-снимком графа, поэтому остаётся валидным после изменения
+ * или уничтожения graph; маршруты до любых целей достаются без нового поиска.
+ */
+template<typename graph_t, typename node_type_t>
+auto shortest_path_tree(const graph_t& graph, node_type_t key_from) {
+    graph[key_from];
+
+    typedef decay_t<decltype(graph.freeze())> csr_t;
+    auto frozen = make_shared<const csr_t>(graph.freeze());
+
+    DijkstraEngine<csr_t> engine(*frozen);
+
+    return ShortestPathTree<csr_t>(frozen, engine.tree(key_from));
+}
+
+/*!
+ * \brief Дерево кратчайших путей из key_from, посчитанное параллельным delta-stepping
+ * @param threads число потоков, 0 - по числу ядер
+ * @param delta ширина корзины, 0 - подобрать по весам рёбер
+ */
+template<typename graph_t, typename node_type_t>
+auto delta_stepping(const graph_t& graph, node_type_t key_from, unsigned threads = 0, double delta = 0) {
+    graph[key_from];
+
+    typedef decay_t<decltype(graph.freeze())> csr_t;
+    typedef typename DeltaSteppingEngine<csr_t>::weight_type weight_t;
+    auto frozen = make_shared<const csr_t>(graph.freeze());
+
+    DeltaSteppingEngine<csr_t> engine(*frozen, threads, static_cast<weight_t>(delta));
+    engine.run(frozen->at(key_from));
+
+    return ShortestPathTree<csr_t>(frozen, engine.tree());
+}
+
+/*!
+ * \brief Обход в ширину из key_from: число рёбер до каждой достижимой вершины и предки
+ * @param threads число потоков, 0 - по числу ядер
+ */
+template<typename graph_t, typename node_type_t>
+auto bfs(const graph_t& graph, node_type_t key_from, unsigned threads = 0) {
+    graph[key_from];
+
+    typedef decay_t<decltype(graph.freeze())> csr_t;
+    auto frozen = make_shared<const csr_t>(graph.freeze());
+    const auto backward = frozen->transpose();
+
+    BfsEngine<csr_t> engine(*frozen, backward, threads);
+    engine.run(frozen->at(key_from));
+
+    return ShortestPathTree<csr_t, typename BfsEngine<csr_t>::hops_type>(frozen, engine.tree());
+}
+
+/*!
+ * \brief Сильные компоненты связности: номер компоненты у каждой вершины
+ *
+ * В один поток - итеративный Тарьян, иначе параллельная обрезка, прямой и обратный
+ * обход и раскраска (см. parallel_scc). Результат владеет CSR-снимком графа.
+ * @param threads число потоков, 0 - по числу ядер
+ */
+template<typename graph_t>
+auto strongly_connected_components(const graph_t& graph, unsigned threads = 0) {
+    typedef decay_t<decltype(graph.freeze())> csr_t;
+    auto frozen = make_shared<const csr_t>(graph.freeze());
 
-    for (auto [key, node] : graph) {
-        d[key] = numeric_limits<weight_t>::max();
-        u[key] = false;
+    if (worker_count(threads, frozen->size(), 1 << 14) == 1) {
+        return ComponentMap<csr_t>(frozen, tarjan_scc(*frozen));
     }
 
-    d[key_from] = 0;
+    const auto backward = frozen->transpose();
+    return ComponentMap<csr_t>(frozen, parallel_scc(*frozen, backward, threads));
+}
 
-    map<node_type_t, node_type_t> possible;
-    possible[key_from] = numeric_limits<node_type_t>::max();
+/*!
+ * \brief Слабые компоненты связности: вершины из разных компонент не соединены никаким путём,
+ * так что запрос между ними можно отклонить без поиска
+ * @param threads число потоков, 0 - по числу ядер
+ */
+template<typename graph_t>
+auto weakly_connected_components(const graph_t& graph, unsigned threads = 0) {
+    typedef decay_t<decltype(graph.freeze())> csr_t;
+    auto frozen = make_shared<const csr_t>(graph.freeze());
 
-    for (auto i = 0; i < graph.size(); i++) {
-        node_type_t v = -1;
+    return ComponentMap<csr_t>(frozen, parallel_wcc(*frozen, threads));
+}
 
-        for (auto [key, node] : graph) {
-            if (!u[key] && (v == -1 || d[key] < d[v])) {
-                v = key;
-            }
-        }
+/*!
+ * \brief Ключи вершин в топологическом порядке (алгоритм Кана); для графа с циклом - исключение
+ */
+template<typename graph_t>
+auto topological_sort(const graph_t& graph) {
+    const auto frozen = graph.freeze();
+    typedef decay_t<decltype(frozen.key(0))> node_type_t;
+
+    vector<typename decay_t<decltype(frozen)>::id_type> order;
+    if (!topological_order(frozen, order)) {
+        throw logic_error("graph has a cycle.\n");
+    }
 
-        if (d[v] == numeric_limits<weight_t>::max()) {
-            break;
-        }
+    vector<node_type_t> result;
+    result.reserve(order.size());
+    for (auto id : order) {
+        result.push_back(frozen.key(id));
+    }
 
-        for (auto [to, len] : graph[v]) {
-            if (len < 0) {
-                throw logic_error("negative weight.\n");
-            }
-            if (d[v] + len < d[to]) {
-                d[to] = d[v] + len;
-                possible[to] = v;
-            }
-        }
+    return result;
+}
+
+/*!
+ * \brief Кратчайший (или длиннейший) путь в ациклическом графе за O(V + E), веса любого знака
+ * @return пара (длина пути, маршрут из ключей)
+ */
+template<typename weight_t, typename route_t, typename graph_t, typename node_type_t>
+pair<weight_t, route_t> dag_path(const graph_t& graph, node_type_t key_from, node_type_t key_to,
+                                 dag_objective objective = dag_objective::shortest) {
+    graph[key_from];
+    graph[key_to];
+
+    const auto frozen = graph.freeze();
+    DagPathEngine<decay_t<decltype(frozen)>> engine(frozen);
+
+    auto [distance, route] = engine.template query<route_t>(key_from, key_to, objective);
+
+    return pair<weight_t, route_t>(distance, route);
+}
+
+/*!
+ * \brief Дерево кратчайших (или длиннейших) путей из key_from в ациклическом графе
+ */
+template<typename graph_t, typename node_type_t>
+auto dag_path_tree(const graph_t& graph, node_type_t key_from, dag_objective objective = dag_objective::shortest) {
+    graph[key_from];
 
-        u[v] = true;
+    typedef decay_t<decltype(graph.freeze())> csr_t;
+    auto frozen = make_shared<const csr_t>(graph.freeze());
 
+    DagPathEngine<csr_t> engine(*frozen);
+
+    return ShortestPathTree<csr_t>(frozen, engine.tree(key_from, objective));
+}
+
+/*!
+ * \brief Критический путь ациклического графа: самый длинный путь, начинающийся в любой вершине
+ * @return пара (длина пути, маршрут из ключей)
+ */
+template<typename weight_t, typename route_t, typename graph_t>
+pair<weight_t, route_t> critical_path(const graph_t& graph) {
+    const auto frozen = graph.freeze();
+    DagPathEngine<decay_t<decltype(frozen)>> engine(frozen);
+
+    auto [distance, route] = engine.template critical_path<route_t>();
+
+    return pair<weight_t, route_t>(distance, route);
+}
+
+/*!
+ * \brief Пакет запросов dijkstra(), выполняемых параллельно
+ *
+ * Вместо исключений у каждого ответа статус: no_node, no_route, negative_weight.
+ * @param queries пары (key_from, key_to)
+ * @param threads число потоков, 0 - по числу ядер
+ * @return ответы в порядке запросов
+ */
+template<typename weight_t, typename route_t, typename graph_t, typename node_type_t>
+vector<PathResult<weight_t, route_t>> dijkstra_batch(const graph_t& graph,
+                                                     const vector<pair<node_type_t, node_type_t>>& queries,
+                                                     unsigned threads = 0) {
+    const auto frozen = graph.freeze();
+    DijkstraBatch<decay_t<decltype(frozen)>> batch(frozen, threads);
+
+    auto answers = batch.template run<route_t>(queries);
+
+    vector<PathResult<weight_t, route_t>> results(answers.size());
+    for (size_t i = 0; i < answers.size(); i++) {
+        results[i].status = answers[i].status;
+        results[i].distance = answers[i].distance;
+        results[i].route = move(answers[i].route);
     }
 
-    if (d[key_to] == numeric_limits<weight_t>::max()) {
-        throw logic_error("no route.\n");
+    return results;
+}
+
+/*!
+ * \brief Кратчайший путь при отрицательных весах (Беллман - Форд с очередью)
+ *
+ * Достижимый из key_from отрицательный цикл - исключение "negative cycle.".
+ * @return пара (длина пути, маршрут из ключей)
+ */
+template<typename weight_t, typename route_t, typename graph_t, typename node_type_t>
+pair<weight_t, route_t> bellman_ford(const graph_t& graph, node_type_t key_from, node_type_t key_to) {
+    graph[key_from];
+    graph[key_to];
+
+    const auto frozen = graph.freeze();
+    BellmanFordEngine<decay_t<decltype(frozen)>> engine(frozen);
+
+    auto [distance, route] = engine.template query<route_t>(key_from, key_to);
+
+    return pair<weight_t, route_t>(distance, route);
+}
+
+/*!
+ * \brief Дерево кратчайших путей из key_from при отрицательных весах
+ */
+template<typename graph_t, typename node_type_t>
+auto bellman_ford_tree(const graph_t& graph, node_type_t key_from) {
+    graph[key_from];
+
+    typedef decay_t<decltype(graph.freeze())> csr_t;
+    auto frozen = make_shared<const csr_t>(graph.freeze());
+
+    BellmanFordEngine<csr_t> engine(*frozen);
+
+    return ShortestPathTree<csr_t>(frozen, engine.tree(key_from));
+}
+
+/*!
+ * \brief Какой-нибудь отрицательный цикл графа (ключи по порядку рёбер) или пустой маршрут, если их нет
+ */
+template<typename route_t, typename graph_t>
+route_t negative_cycle(const graph_t& graph) {
+    const auto frozen = graph.freeze();
+    BellmanFordEngine<decay_t<decltype(frozen)>> engine(frozen);
+
+    engine.try_run_all();
+    return engine.template negative_cycle<route_t>();
+}
+
+/*!
+ * \brief Пакет запросов при отрицательных весах: перевзвешивание Джонсона и параллельный Дейкстра
+ * @param queries пары (key_from, key_to)
+ * @param threads число потоков, 0 - по числу ядер
+ * @return ответы в порядке запросов
+ */
+template<typename weight_t, typename route_t, typename graph_t, typename node_type_t>
+vector<PathResult<weight_t, route_t>> johnson_batch(const graph_t& graph,
+                                                    const vector<pair<node_type_t, node_type_t>>& queries,
+                                                    unsigned threads = 0) {
+    const auto frozen = graph.freeze();
+    JohnsonEngine<decay_t<decltype(frozen)>> engine(frozen, threads);
+
+    auto answers = engine.template run<route_t>(queries);
+
+    vector<PathResult<weight_t, route_t>> results(answers.size());
+    for (size_t i = 0; i < answers.size(); i++) {
+        results[i].status = answers[i].status;
+        results[i].distance = answers[i].distance;
+        results[i].route = move(answers[i].route);
     }
 
-    route_t route;
+    return results;
+}
+
+/*!
+ * \brief Кратчайшие пути между всеми парами (алгоритм Джонсона): дерево на каждую вершину
+ * в порядке ключей; все деревья совместно владеют одним CSR-снимком
+ * @param threads число потоков, 0 - по числу ядер
+ */
+template<typename graph_t>
+auto johnson_all_pairs(const graph_t& graph, unsigned threads = 0) {
+    typedef decay_t<decltype(graph.freeze())> csr_t;
+    auto frozen = make_shared<const csr_t>(graph.freeze());
+
+    JohnsonEngine<csr_t> engine(*frozen, threads);
+    auto trees = engine.all_pairs();
 
-    for (auto key = key_to; possible[key] < numeric_limits<node_type_t>::max(); ) {
-        route.push_back(key);
-        key = possible[key];
+    for (auto& tree : trees) {
+        tree = ShortestPathTree<csr_t>(frozen, move(tree));
     }
 
-    route.push_back(key_from);
-    reverse(route.begin(), route.end());
+    return trees;
+}
+
+/*!
+ * \brief Кратчайший путь двунаправленным Дейкстрой: встречные поиски от начала и от конца
+ *
+ * Для близких вершин просматривается лишь малая часть графа, но каждый вызов строит
+ * CSR-снимок и обратный к нему граф за O(V + E); для серии запросов выгоднее один раз
+ * вызвать freeze() и transpose() и пользоваться BidirectionalDijkstraEngine напрямую.
+ * Отрицательное ребро - исключение "negative weight.", только если поиск до него дошёл.
+ * @return пара (длина пути, маршрут из ключей)
+ */
+template<typename weight_t, typename route_t, typename graph_t, typename node_type_t>
+pair<weight_t, route_t> bidirectional_dijkstra(const graph_t& graph, node_type_t key_from, node_type_t key_to) {
+    graph[key_from];
+    graph[key_to];
+
+    const auto forward = graph.freeze();
+    const auto backward = forward.transpose();
+    BidirectionalDijkstraEngine<decay_t<decltype(forward)>> engine(forward, backward);
+
+    auto [distance, route] = engine.template query<route_t>(key_from, key_to);
+
+    return pair<weight_t, route_t>(distance, route);
+}
+
+/*!
+ * \brief Иерархия сжатий графа для серии быстрых запросов "точка-точка"
+ *
+ * Предобработка дорогая, поэтому иерархия строится один раз и переиспользуется
+ * в contraction_hierarchy_path(). Она владеет CSR-снимком графа: последующие
+ * изменения graph в ней не видны.
+ * @param witness_limit сколько вершин может просмотреть один поиск-свидетель
+ */
+template<typename graph_t>
+auto contraction_hierarchy(const graph_t& graph, size_t witness_limit = 500) {
+    typedef decay_t<decltype(graph.freeze())> csr_t;
+
+    return ContractionHierarchy<csr_t>(make_shared<const csr_t>(graph.freeze()), witness_limit);
+}
+
+/*!
+ * \brief Кратчайший путь по иерархии сжатий; результат тот же, что у dijkstra() на графе в момент построения
+ * @return пара (длина пути, маршрут из ключей)
+ */
+template<typename weight_t, typename route_t, typename csr_t, typename node_type_t>
+pair<weight_t, route_t> contraction_hierarchy_path(ContractionHierarchy<csr_t>& hierarchy,
+                                                   node_type_t key_from, node_type_t key_to) {
+    auto [distance, route] = hierarchy.template query<route_t>(key_from, key_to);
+
+    return pair<weight_t, route_t>(distance, route);
+}
+
+/*!
+ * \brief Кратчайший путь поиском A* с эвристикой по значениям вершин
+ *
+ * Каждый вызов строит CSR-снимок графа за O(V + E); для серии запросов выгоднее один
+ * раз вызвать freeze() и пользоваться AStarEngine на этом снимке.
+ * @param heuristic heuristic(значение вершины, значение цели), по умолчанию евклидово расстояние
+ * @param inflation множитель эвристики; больше 1 - быстрее, но путь до inflation раз длиннее оптимального
+ * @return пара (длина пути, маршрут из ключей)
+ */
+template<typename weight_t, typename route_t, typename graph_t, typename node_type_t,
+        typename heuristic_t = euclidean_heuristic>
+pair<weight_t, route_t> astar(const graph_t& graph, node_type_t key_from, node_type_t key_to,
+                              heuristic_t heuristic = heuristic_t(), double inflation = 1.0) {
+    graph[key_from];
+    graph[key_to];
+
+    const auto frozen = graph.freeze();
+    AStarEngine<decay_t<decltype(frozen)>, heuristic_t> engine(frozen, heuristic, inflation);
 
+    auto [distance, route] = engine.template query<route_t>(key_from, key_to);
 
-    return pair<weight_t, route_t>(d[key_to], route);
+    return pair<weight_t, route_t>(distance, route);
 }
@@ -0,0 +1,651 @@
+#pragma once
+
+#include <string>
+#include <string_view>
+#include <vector>
+#include <memory>
+#include <limits>
+#include <cstdint>
+#include <cstring>
+#include <fstream>
+#include <utility>
+#include <numeric>
+#include <algorithm>
+#include <stdexcept>
+#include <type_traits>
+#include "CsrGraph.h"
+
+#ifdef _WIN32
+#ifndef NOMINMAX
+#define NOMINMAX
+#endif
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#endif
+
+
+/*!
+ * \brief Файл, целиком отображённый в память только для чтения
+ */
+class FileMapping {
+    const char* data_ = nullptr;
+    std::size_t size_ = 0;
+
+public:
+    explicit FileMapping(const std::string& path) {
+#ifdef _WIN32
+        HANDLE file = CreateFileA(path.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING,
+                                  FILE_ATTRIBUTE_NORMAL, nullptr);
+        if (file == INVALID_HANDLE_VALUE) {
+            throw std::runtime_error("cannot open file.\n");
+        }
+
+        LARGE_INTEGER size;
+        if (!GetFileSizeEx(file, &size)) {
+            CloseHandle(file);
+            throw std::runtime_error("cannot open file.\n");
+        }
+        size_ = static_cast<std::size_t>(size.QuadPart);
+
+        if (size_ != 0) {
+            HANDLE mapping = CreateFileMappingA(file, nullptr, PAGE_READONLY, 0, 0, nullptr);
+            if (mapping != nullptr) {
+                data_ = static_cast<const char*>(MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0));
+                CloseHandle(mapping);
+            }
+        }
+        CloseHandle(file);
+
+        if (size_ != 0 && data_ == nullptr) {
+            throw std::runtime_error("cannot map file.\n");
+        }
+#else
+        int fd = ::open(path.c_str(), O_RDONLY);
+        if (fd < 0) {
+            throw std::runtime_error("cannot open file.\n");
+        }
+
+        struct stat info;
+        if (::fstat(fd, &info) != 0) {
+            ::close(fd);
+            throw std::runtime_error("cannot open file.\n");
+        }
+        size_ = static_cast<std::size_t>(info.st_size);
+
+        if (size_ != 0) {
+            void* data = ::mmap(nullptr, size_, PROT_READ, MAP_PRIVATE, fd, 0);
+            if (data == MAP_FAILED) {
+                ::close(fd);
+                throw std::runtime_error("cannot map file.\n");
+            }
+            data_ = static_cast<const char*>(data);
+        }
+        ::close(fd);
+#endif
+    }
+
+    FileMapping(const FileMapping& other) = delete;
+
+    FileMapping& operator=(const FileMapping& rhs) = delete;
+
+    ~FileMapping() {
+        if (data_ == nullptr) {
+            return;
+        }
+
+#ifdef _WIN32
+        UnmapViewOfFile(data_);
+#else
+        ::munmap(const_cast<char*>(data_), size_);
+#endif
+    }
+
+    const char* data() const {
+        return data_;
+    }
+
+    std::size_t size() const {
+        return size_;
+    }
+};
+
+
+/*!
+ * \brief Заголовок бинарного файла графа
+ *
+ * За заголовком идут секции, каждая с границы 64 байт: ключи (по возрастанию),
+ * значения, смещения CSR (uint64, size + 1 штук), концы рёбер (uint32), веса.
+ * Ключи фиксированного размера (key_encoding == fixed_keys) лежат массивом.
+ * Строковые ключи (string_keys, key_size == 0) - это смещения начала каждого
+ * ключа в блоке байт (uint64, size + 1 штук) и сам блок с key_bytes_offset;
+ * они упорядочены побайтно. checksum покрывает всё после заголовка.
+ */
+struct GraphFileHeader {
+    static constexpr std::uint32_t current_version = 1;
+    static constexpr std::uint32_t byte_order_mark = 0x01020304;
+
+    static constexpr std::uint32_t fixed_keys = 0;
+    static constexpr std::uint32_t string_keys = 1;
+
+    char magic[8];
+    std::uint32_t version;
+    std::uint32_t byte_order;
+    std::uint32_t key_size;
+    std::uint32_t value_size;
+    std::uint32_t weight_size;
+    std::uint32_t key_encoding;
+    std::uint64_t node_count;
+    std::uint64_t edge_count;
+    std::uint64_t keys_offset;
+    std::uint64_t values_offset;
+    std::uint64_t offsets_offset;
+    std::uint64_t targets_offset;
+    std::uint64_t weights_offset;
+    std::uint64_t file_size;
+    std::uint64_t checksum;
+    std::uint64_t key_bytes_offset;
+    char padding[16];
+
+    static constexpr std::size_t alignment = 64;
+
+    static std::uint64_t align(std::uint64_t offset) {
+        return (offset + alignment - 1) / alignment * alignment;
+    }
+
+    static bool magic_matches(const char* magic) {
+        return std::memcmp(magic, "GRAPHCSR", 8) == 0;
+    }
+};
+
+static_assert(sizeof(GraphFileHeader) == 128, "graph file header must be 128 bytes");
+
+
+/*!
+ * \brief Контрольная сумма: FNV-1a по 64-битным словам (длина кратна 8)
+ */
+inline std::uint64_t graph_file_checksum(std::uint64_t state, const char* data, std::size_t bytes) {
+    for (std::size_t i = 0; i + 8 <= bytes; i += 8) {
+        std::uint64_t word;
+        std::memcpy(&word, data + i, 8);
+        state = (state ^ word) * 0x100000001b3ull;
+    }
+
+    return state;
+}
+
+constexpr std::uint64_t graph_file_checksum_seed = 0xcbf29ce484222325ull;
+
+
+template<typename key_t, typename = void>
+struct graph_file_has_str : std::false_type {};
+
+template<typename key_t>
+struct graph_file_has_str<key_t, std::void_t<decltype(std::string_view(std::declval<const key_t&>().str()))>>
+        : std::true_type {};
+
+/*!
+ * \brief Пишутся ли ключи типа key_t строками: строки, string_view и всё, у чего есть str() (Symbol)
+ */
+template<typename key_t>
+constexpr bool graph_file_string_key = std::is_convertible<const key_t&, std::string_view>::value ||
+                                       graph_file_has_str<key_t>::value;
+
+template<typename key_t>
+std::string_view graph_file_key_bytes(const key_t& key) {
+    if constexpr (std::is_convertible<const key_t&, std::string_view>::value) {
+        return key;
+    } else {
+        return key.str();
+    }
+}
+
+
+/*!
+ * \brief Записать CSR-граф в бинарный файл для MappedGraph
+ *
+ * Значения и веса пишутся побайтно, поэтому их типы должны быть тривиально
+ * копируемыми. Ключи-строки (std::string, string_view, Symbol) пишутся своими
+ * символами в секцию переменной длины, вершины при этом перенумеровываются в
+ * побайтном порядке ключей; прочие ключи - побайтно, как значения.
+ * @tparam csr_t CsrGraph, MappedGraph или совместимое представление
+ */
+template<typename csr_t>
+void write_graph_file(const csr_t& graph, const std::string& path) {
+    typedef std::decay_t<decltype(graph.key(0))> key_t;
+    typedef std::decay_t<decltype(graph.value(0))> value_t;
+    typedef std::decay_t<decltype(graph.weight(0))> weight_t;
+    typedef typename csr_t::id_type id_t;
+
+    constexpr bool string_keys = graph_file_string_key<key_t>;
+
+    static_assert(string_keys || std::is_trivially_copyable<key_t>::value,
+                  "key type must be a string or trivially copyable");
+    static_assert(std::is_trivially_copyable<value_t>::value, "value type must be trivially copyable");
+    static_assert(std::is_trivially_copyable<weight_t>::value, "weight type must be trivially copyable");
+    static_assert(sizeof(id_t) == sizeof(std::uint32_t), "node ids must be 32-bit");
+
+    std::uint64_t n = graph.size(), m = graph.edge_count();
+
+    // order[i] - вершина, которая в файле получит id i; rank - обратная перестановка
+    std::vector<id_t> order, rank;
+    std::uint64_t key_bytes = 0;
+    if constexpr (string_keys) {
+        order.resize(n);
+        std::iota(order.begin(), order.end(), id_t(0));
+
+        auto by_bytes = [&](id_t lhs, id_t rhs) {
+            return graph_file_key_bytes(graph.key(lhs)) < graph_file_key_bytes(graph.key(rhs));
+        };
+        if (!std::is_sorted(order.begin(), order.end(), by_bytes)) {
+            std::sort(order.begin(), order.end(), by_bytes);
+        }
+
+        rank.resize(n);
+        for (std::uint64_t i = 0; i < n; i++) {
+            rank[order[i]] = static_cast<id_t>(i);
+            key_bytes += graph_file_key_bytes(graph.key(order[i])).size();
+        }
+    }
+
+    auto original = [&](std::uint64_t v) {
+        return string_keys ? order[v] : static_cast<id_t>(v);
+    };
+
+    GraphFileHeader header;
+    std::memset(&header, 0, sizeof(header));
+    std::memcpy(header.magic, "GRAPHCSR", 8);
+    header.version = GraphFileHeader::current_version;
+    header.byte_order = GraphFileHeader::byte_order_mark;
+    header.key_size = string_keys ? 0 : sizeof(key_t);
+    header.key_encoding = string_keys ? GraphFileHeader::string_keys : GraphFileHeader::fixed_keys;
+    header.value_size = sizeof(value_t);
+    header.weight_size = sizeof(weight_t);
+    header.node_count = n;
+    header.edge_count = m;
+    header.keys_offset = sizeof(GraphFileHeader);
+    if (string_keys) {
+        header.key_bytes_offset = GraphFileHeader::align(header.keys_offset + (n + 1) * sizeof(std::uint64_t));
+        header.values_offset = GraphFileHeader::align(header.key_bytes_offset + key_bytes);
+    } else {
+        header.values_offset = GraphFileHeader::align(header.keys_offset + n * sizeof(key_t));
+    }
+    header.offsets_offset = GraphFileHeader::align(header.values_offset + n * sizeof(value_t));
+    header.targets_offset = GraphFileHeader::align(header.offsets_offset + (n + 1) * sizeof(std::uint64_t));
+    header.weights_offset = GraphFileHeader::align(header.targets_offset + m * sizeof(std::uint32_t));
+    header.file_size = GraphFileHeader::align(header.weights_offset + m * sizeof(weight_t));
+
+    std::ofstream out(path, std::ios::binary | std::ios::trunc);
+    if (!out) {
+        throw std::runtime_error("cannot open file.\n");
+    }
+
+    // в файл уходят куски длиной кратной 8 байтам, поэтому контрольная сумма считается прямо по ним
+    std::vector<char> buffer;
+    buffer.reserve(1 << 16);
+    std::uint64_t checksum = graph_file_checksum_seed;
+    std::uint64_t position = sizeof(GraphFileHeader);
+
+    out.write(reinterpret_cast<const char*>(&header), sizeof(header));
+
+    auto flush = [&]() {
+        checksum = graph_file_checksum(checksum, buffer.data(), buffer.size());
+        out.write(buffer.data(), static_cast<std::streamsize>(buffer.size()));
+        buffer.clear();
+    };
+
+    auto put = [&](const void* data, std::size_t bytes) {
+        const char* bytes_ptr = static_cast<const char*>(data);
+        buffer.insert(buffer.end(), bytes_ptr, bytes_ptr + bytes);
+        position += bytes;
+        if (buffer.size() >= (1 << 16)) {
+            std::size_t whole = buffer.size() / 8 * 8;
+            checksum = graph_file_checksum(checksum, buffer.data(), whole);
+            out.write(buffer.data(), static_cast<std::streamsize>(whole));
+            buffer.erase(buffer.begin(), buffer.begin() + whole);
+        }
+    };
+
+    auto pad_to = [&](std::uint64_t offset) {
+        buffer.resize(buffer.size() + (offset - position), 0);
+        position = offset;
+    };
+
+    if constexpr (string_keys) {
+        std::uint64_t offset = 0;
+        put(&offset, sizeof(offset));
+        for (std::uint64_t v = 0; v < n; v++) {
+            offset += graph_file_key_bytes(graph.key(order[v])).size();
+            put(&offset, sizeof(offset));
+        }
+        pad_to(header.key_bytes_offset);
+
+        for (std::uint64_t v = 0; v < n; v++) {
+            std::string_view bytes = graph_file_key_bytes(graph.key(order[v]));
+            put(bytes.data(), bytes.size());
+        }
+    } else {
+        for (std::uint64_t v = 0; v < n; v++) {
+            key_t key = graph.key(static_cast<id_t>(v));
+            put(&key, sizeof(key));
+        }
+    }
+    pad_to(header.values_offset);
+
+    for (std::uint64_t v = 0; v < n; v++) {
+        value_t value = graph.value(original(v));
+        put(&value, sizeof(value));
+    }
+    pad_to(header.offsets_offset);
+
+    std::uint64_t edge_offset = 0;
+    put(&edge_offset, sizeof(edge_offset));
+    for (std::uint64_t v = 0; v < n; v++) {
+        edge_offset += graph.edge_end(original(v)) - graph.edge_begin(original(v));
+        put(&edge_offset, sizeof(edge_offset));
+    }
+    pad_to(header.targets_offset);
+
+    for (std::uint64_t v = 0; v < n; v++) {
+        for (std::size_t e = graph.edge_begin(original(v)); e < graph.edge_end(original(v)); e++) {
+            std::uint32_t target = string_keys ? rank[graph.target(e)] : graph.target(e);
+            put(&target, sizeof(target));
+        }
+    }
+    pad_to(header.weights_offset);
+
+    for (std::uint64_t v = 0; v < n; v++) {
+        for (std::size_t e = graph.edge_begin(original(v)); e < graph.edge_end(original(v)); e++) {
+            weight_t weight = graph.weight(e);
+            put(&weight, sizeof(weight));
+        }
+    }
+    pad_to(header.file_size);
+    flush();
+
+    header.checksum = checksum;
+    out.seekp(0);
+    out.write(reinterpret_cast<const char*>(&header), sizeof(header));
+
+    if (!out) {
+        throw std::runtime_error("cannot write file.\n");
+    }
+}
+
+
+/*!
+ * \brief Граф только для чтения прямо поверх отображённого в память файла write_graph_file()
+ *
+ * Открытие не разбирает данные: массивы CSR читаются из страниц файла по мере
+ * обращения. Интерфейс тот же, что у CsrGraph, поэтому подходит для всех движков
+ * поиска. Копии разделяют одно отображение. Файл со строковыми ключами
+ * открывается как MappedGraph<std::string_view, ...>: key() возвращает
+ * string_view прямо на байты файла.
+ * @tparam key_type std::string_view для строковых ключей, иначе тип ключей файла
+ * @tparam value_type
+ * @tparam weight_type
+ */
+template<typename key_type, typename value_type, typename weight_type>
+class MappedGraph {
+public:
+    typedef std::uint32_t id_type;
+
+    static constexpr id_type npos = std::numeric_limits<id_type>::max();
+
+    static constexpr bool string_keys = std::is_same<key_type, std::string_view>::value;
+
+    /*!
+     * \brief Тип ключей копии в памяти (load()): строковые ключи копируются в std::string
+     */
+    typedef std::conditional_t<string_keys, std::string, key_type> owned_key_type;
+
+private:
+    struct Transposed {
+        std::shared_ptr<const void> base;
+        std::vector<std::uint64_t> offsets;
+        std::vector<id_type> targets;
+        std::vector<weight_type> weights;
+    };
+
+    std::shared_ptr<const void> storage_;
+    std::size_t size_ = 0;
+    std::size_t edges_ = 0;
+    const key_type* keys_ = nullptr;
+    const std::uint64_t* key_offsets_ = nullptr;
+    const char* key_bytes_ = nullptr;
+    const value_type* values_ = nullptr;
+    const std::uint64_t* offsets_ = nullptr;
+    const id_type* targets_ = nullptr;
+    const weight_type* weights_ = nullptr;
+
+    MappedGraph() = default;
+
+    static void check(bool condition) {
+        if (!condition) {
+            throw std::runtime_error("bad graph file.\n");
+        }
+    }
+
+public:
+    /*!
+     * \param verify проверить контрольную сумму и целостность CSR (чтение всего файла)
+     */
+    explicit MappedGraph(const std::string& path, bool verify = true) {
+        auto mapping = std::make_shared<FileMapping>(path);
+        const char* data = mapping->data();
+
+        check(mapping->size() >= sizeof(GraphFileHeader));
+        GraphFileHeader header;
+        std::memcpy(&header, data, sizeof(header));
+
+        check(GraphFileHeader::magic_matches(header.magic));
+        if (header.version != GraphFileHeader::current_version) {
+            throw std::runtime_error("unsupported graph file version.\n");
+        }
+        check(header.byte_order == GraphFileHeader::byte_order_mark);
+        std::uint32_t key_encoding = string_keys ? GraphFileHeader::string_keys : GraphFileHeader::fixed_keys;
+        std::uint32_t key_size = string_keys ? 0 : sizeof(key_type);
+        if (header.key_encoding != key_encoding || header.key_size != key_size ||
+            header.value_size != sizeof(value_type) || header.weight_size != sizeof(weight_type)) {
+            throw std::runtime_error("graph file types do not match.\n");
+        }
+
+        std::uint64_t n = header.node_count, m = header.edge_count;
+        check(n < npos && m <= header.file_size && header.file_size == mapping->size());
+        check(header.keys_offset == sizeof(GraphFileHeader));
+        if (string_keys) {
+            check(header.key_bytes_offset >= header.keys_offset + (n + 1) * sizeof(std::uint64_t) &&
+                  header.key_bytes_offset <= header.values_offset &&
+                  header.key_bytes_offset % GraphFileHeader::alignment == 0);
+        } else {
+            check(header.values_offset >= header.keys_offset + n * sizeof(key_type));
+        }
+        check(header.offsets_offset >= header.values_offset + n * sizeof(value_type));
+        check(header.targets_offset >= header.offsets_offset + (n + 1) * sizeof(std::uint64_t));
+        check(header.weights_offset >= header.targets_offset + m * sizeof(id_type));
+        check(header.file_size >= header.weights_offset + m * sizeof(weight_type));
+        check(header.values_offset % GraphFileHeader::alignment == 0 &&
+              header.offsets_offset % GraphFileHeader::alignment == 0 &&
+              header.targets_offset % GraphFileHeader::alignment == 0 &&
+              header.weights_offset % GraphFileHeader::alignment == 0 &&
+              header.file_size % GraphFileHeader::alignment == 0);
+
+        size_ = n;
+        edges_ = m;
+        if (string_keys) {
+            key_offsets_ = reinterpret_cast<const std::uint64_t*>(data + header.keys_offset);
+            key_bytes_ = data + header.key_bytes_offset;
+            check(key_offsets_[0] == 0 && key_offsets_[n] <= header.values_offset - header.key_bytes_offset);
+        } else {
+            keys_ = reinterpret_cast<const key_type*>(data + header.keys_offset);
+        }
+        values_ = reinterpret_cast<const value_type*>(data + header.values_offset);
+        offsets_ = reinterpret_cast<const std::uint64_t*>(data + header.offsets_offset);
+        targets_ = reinterpret_cast<const id_type*>(data + header.targets_offset);
+        weights_ = reinterpret_cast<const weight_type*>(data + header.weights_offset);
+
+        check(offsets_[0] == 0 && offsets_[n] == m);
+
+        if (verify) {
+            std::size_t payload = mapping->size() - sizeof(GraphFileHeader);
+            check(graph_file_checksum(graph_file_checksum_seed, data + sizeof(GraphFileHeader), payload) ==
+                  header.checksum);
+
+            for (std::size_t v = 0; v < n; v++) {
+                check(offsets_[v] <= offsets_[v + 1]);
+                check(!string_keys || key_offsets_[v] <= key_offsets_[v + 1]);
+            }
+            for (std::size_t v = 1; v < n; v++) {
+                check(key(static_cast<id_type>(v - 1)) < key(static_cast<id_type>(v)));
+            }
+            for (std::size_t e = 0; e < m; e++) {
+                check(targets_[e] < n);
+            }
+        }
+
+        storage_ = std::move(mapping);
+    }
+
+    bool empty() const {
+        return size_ == 0;
+    }
+
+    std::size_t size() const {
+        return size_;
+    }
+
+    std::size_t edge_count() const {
+        return edges_;
+    }
+
+    /*!
+     * \brief Плотный id вершины по ключу, npos если вершины нет
+     */
+    id_type id(const key_type& key) const {
+        std::size_t lo = 0, hi = size_;
+        while (lo < hi) {
+            std::size_t middle = lo + (hi - lo) / 2;
+            if (this->key(static_cast<id_type>(middle)) < key) {
+                lo = middle + 1;
+            } else {
+                hi = middle;
+            }
+        }
+
+        if (lo == size_ || key < this->key(static_cast<id_type>(lo))) {
+            return npos;
+        }
+
+        return static_cast<id_type>(lo);
+    }
+
+    bool contains(const key_type& key) const {
+        return id(key) != npos;
+    }
+
+    id_type at(const key_type& key) const {
+        id_type result = id(key);
+        if (result == npos) {
+            throw std::logic_error("no such node.\n");
+        }
+
+        return result;
+    }
+
+    /*!
+     * \brief Ключ вершины: ссылка в файл, а для строковых ключей - string_view на его байты
+     */
+    std::conditional_t<string_keys, key_type, const key_type&> key(id_type id) const {
+        if constexpr (string_keys) {
+            return key_type(key_bytes_ + key_offsets_[id], key_offsets_[id + 1] - key_offsets_[id]);
+        } else {
+            return keys_[id];
+        }
+    }
+
+    const value_type& value(id_type id) const {
+        return values_[id];
+    }
+
+    std::size_t degree_out(id_type id) const {
+        return offsets_[id + 1] - offsets_[id];
+    }
+
+    std::size_t edge_begin(id_type id) const {
+        return offsets_[id];
+    }
+
+    std::size_t edge_end(id_type id) const {
+        return offsets_[id + 1];
+    }
+
+    id_type target(std::size_t edge) const {
+        return targets_[edge];
+    }
+
+    const weight_type& weight(std::size_t edge) const {
+        return weights_[edge];
+    }
+
+    /*!
+     * \brief Граф с развёрнутыми рёбрами: ключи и значения остаются в файле, рёбра строятся в памяти
+     */
+    MappedGraph transpose() const {
+        auto transposed = std::make_shared<Transposed>();
+        transposed->base = storage_;
+        transposed->offsets.assign(size_ + 1, 0);
+        transposed->targets.resize(edges_);
+        transposed->weights.resize(edges_);
+
+        auto& offsets = transposed->offsets;
+        for (std::size_t e = 0; e < edges_; e++) {
+            offsets[targets_[e] + 1]++;
+        }
+        for (std::size_t v = 0; v < size_; v++) {
+            offsets[v + 1] += offsets[v];
+        }
+
+        std::vector<std::uint64_t> next(offsets.begin(), offsets.end() - 1);
+        for (id_type from = 0; from < size_; from++) {
+            for (std::size_t e = offsets_[from]; e < offsets_[from + 1]; e++) {
+                std::uint64_t place = next[targets_[e]]++;
+                transposed->targets[place] = from;
+                transposed->weights[place] = weights_[e];
+            }
+        }
+
+        MappedGraph result;
+        result.size_ = size_;
+        result.edges_ = edges_;
+        result.keys_ = keys_;
+        result.key_offsets_ = key_offsets_;
+        result.key_bytes_ = key_bytes_;
+        result.values_ = values_;
+        result.offsets_ = transposed->offsets.data();
+        result.targets_ = transposed->targets.data();
+        result.weights_ = transposed->weights.data();
+        result.storage_ = std::move(transposed);
+
+        return result;
+    }
+
+    /*!
+     * \brief Копия в памяти, не зависящая от файла
+     */
+    CsrGraph<owned_key_type, value_type, weight_type> load() const {
+        std::vector<owned_key_type> keys;
+        keys.reserve(size_);
+        for (id_type v = 0; v < size_; v++) {
+            keys.emplace_back(key(v));
+        }
+
+        return CsrGraph<owned_key_type, value_type, weight_type>(
+                std::move(keys), std::vector<value_type>(values_, values_ + size_),
+                std::vector<std::size_t>(offsets_, offsets_ + size_ + 1),
+                std::vector<id_type>(targets_, targets_ + edges_),
+                std::vector<weight_type>(weights_, weights_ + edges_));
+    }
+};
@@ -0,0 +1,236 @@
+#pragma once
+
+#include <vector>
+#include <memory>
+#include <utility>
+#include <algorithm>
+#include <stdexcept>
+#include "Parallel.h"
+#include "Dijkstra.h"
+#include "BatchQuery.h"
+#include "BellmanFord.h"
+#include "ShortestPathTree.h"
+
+
+/*!
+ * \brief CSR-граф с весами, перевзвешенными потенциалами: w'(u, v) = w(u, v) + h(u) - h(v)
+ *
+ * Ключи и рёбра берутся у исходного графа, хранятся только новые веса. Если h -
+ * расстояния Беллмана - Форда, все w' неотрицательны и по ним работает Дейкстра.
+ * @tparam csr_t CsrGraph или совместимое представление
+ */
+template<typename csr_t>
+class ReweightedGraph {
+public:
+    typedef typename csr_t::id_type id_type;
+    typedef std::decay_t<decltype(std::declval<const csr_t&>().weight(0))> weight_type;
+
+    static constexpr id_type npos = csr_t::npos;
+
+private:
+    const csr_t* graph_;
+    std::vector<weight_type> weights_;
+
+public:
+    ReweightedGraph(const csr_t& graph, const std::vector<weight_type>& potential)
+            : graph_(&graph), weights_(graph.edge_count()) {
+        for (id_type v = 0; v < graph.size(); v++) {
+            for (std::size_t e = graph.edge_begin(v); e < graph.edge_end(v); e++) {
+                // ошибка округления не должна давать Дейкстре отрицательный вес
+                weights_[e] = std::max(weight_type(), graph.weight(e) + potential[v] - potential[graph.target(e)]);
+            }
+        }
+    }
+
+    const csr_t& original() const {
+        return *graph_;
+    }
+
+    std::size_t size() const {
+        return graph_->size();
+    }
+
+    std::size_t edge_count() const {
+        return graph_->edge_count();
+    }
+
+    template<typename node_type_t>
+    id_type id(const node_type_t& key) const {
+        return graph_->id(key);
+    }
+
+    template<typename node_type_t>
+    id_type at(const node_type_t& key) const {
+        return graph_->at(key);
+    }
+
+    decltype(auto) key(id_type id) const {
+        return graph_->key(id);
+    }
+
+    std::size_t edge_begin(id_type id) const {
+        return graph_->edge_begin(id);
+    }
+
+    std::size_t edge_end(id_type id) const {
+        return graph_->edge_end(id);
+    }
+
+    id_type target(std::size_t edge) const {
+        return graph_->target(edge);
+    }
+
+    const weight_type& weight(std::size_t edge) const {
+        return weights_[edge];
+    }
+};
+
+
+/*!
+ * \brief Кратчайшие пути между всеми парами при отрицательных весах (алгоритм Джонсона)
+ *
+ * Один раз: Беллман - Форд от всех вершин даёт потенциалы h, веса
+ * перевзвешиваются в неотрицательные. Дальше каждый источник - обычный Дейкстра
+ * на куче, источники обрабатываются параллельно на пуле потоков со своим
+ * DijkstraEngine у каждого потока; расстояния переводятся обратно:
+ * d(s, t) = d'(s, t) - h(s) + h(t). Всего O(VE log V) вместо O(V^3).
+ * Граф с отрицательным циклом отвергается исключением "negative cycle.".
+ * @tparam csr_t CsrGraph или совместимое представление
+ */
+template<typename csr_t>
+class JohnsonEngine {
+public:
+    typedef typename csr_t::id_type id_type;
+    typedef typename ReweightedGraph<csr_t>::weight_type weight_type;
+
+    static constexpr id_type npos = csr_t::npos;
+
+private:
+    const csr_t* graph_;
+    std::vector<weight_type> potential_;
+    std::unique_ptr<ReweightedGraph<csr_t>> reweighted_;
+    ThreadPool pool_;
+    std::vector<std::unique_ptr<DijkstraEngine<ReweightedGraph<csr_t>>>> engines_;
+
+    static std::vector<weight_type> potentials(const csr_t& graph) {
+        BellmanFordEngine<csr_t> engine(graph);
+        if (engine.try_run_all() == query_status::negative_cycle) {
+            throw std::logic_error("negative cycle.\n");
+        }
+
+        std::vector<weight_type> result(graph.size());
+        for (id_type v = 0; v < graph.size(); v++) {
+            result[v] = engine.distance(v);
+        }
+
+        return result;
+    }
+
+    ShortestPathTree<csr_t> tree_of(DijkstraEngine<ReweightedGraph<csr_t>>& engine, id_type source) const {
+        engine.run(source);
+
+        std::vector<weight_type> dist(graph_->size(), weight_type());
+        std::vector<id_type> parent(graph_->size(), npos);
+        for (id_type v = 0; v < graph_->size(); v++) {
+            if (engine.reached(v)) {
+                dist[v] = engine.distance(v) - potential_[source] + potential_[v];
+                parent[v] = engine.parent(v);
+            }
+        }
+
+        return ShortestPathTree<csr_t>(*graph_, source, std::move(dist), std::move(parent));
+    }
+
+public:
+    /*!
+     * \param threads число потоков, 0 - по числу ядер
+     */
+    explicit JohnsonEngine(const csr_t& graph, unsigned threads = 0)
+            : graph_(&graph), potential_(potentials(graph)),
+              reweighted_(new ReweightedGraph<csr_t>(graph, potential_)), pool_(threads) {
+        for (unsigned worker = 0; worker < pool_.size(); worker++) {
+            engines_.emplace_back(new DijkstraEngine<ReweightedGraph<csr_t>>(*reweighted_));
+        }
+    }
+
+    const csr_t& graph() const {
+        return *graph_;
+    }
+
+    unsigned threads() const {
+        return pool_.size();
+    }
+
+    /*!
+     * \brief Потенциал вершины: расстояние до неё от добавленного источника с нулевыми рёбрами во все вершины
+     */
+    const weight_type& potential(id_type id) const {
+        return potential_[id];
+    }
+
+    /*!
+     * \brief Дерево кратчайших путей из key_from с исходными (не перевзвешенными) расстояниями
+     */
+    template<typename node_type_t>
+    ShortestPathTree<csr_t> tree(const node_type_t& key_from) {
+        return tree_of(*engines_[0], graph_->at(key_from));
+    }
+
+    /*!
+     * \brief Деревья из всех вершин (по дереву на источник, в порядке id); память O(V^2)
+     */
+    std::vector<ShortestPathTree<csr_t>> all_pairs() {
+        std::vector<ShortestPathTree<csr_t>> result(graph_->size());
+
+        pool_.run(graph_->size(), [&](unsigned worker, std::size_t source) {
+            result[source] = tree_of(*engines_[worker], static_cast<id_type>(source));
+        });
+
+        return result;
+    }
+
+    /*!
+     * \brief Ответы на запросы (key_from, key_to) в том же порядке, как у DijkstraBatch
+     */
+    template<typename route_t, typename node_type_t>
+    std::vector<PathResult<weight_type, route_t>> run(const std::vector<std::pair<node_type_t, node_type_t>>& queries) {
+        std::vector<PathResult<weight_type, route_t>> results(queries.size());
+
+        pool_.run(queries.size(), [&](unsigned worker, std::size_t index) {
+            PathResult<weight_type, route_t>& result = results[index];
+            id_type from = graph_->id(queries[index].first);
+            id_type to = graph_->id(queries[index].second);
+
+            if (from == npos || to == npos) {
+                result.status = query_status::no_node;
+                return;
+            }
+
+            DijkstraEngine<ReweightedGraph<csr_t>>& engine = *engines_[worker];
+            result.status = engine.try_run(from, to);
+            if (result.status == query_status::ok) {
+                result.distance = engine.distance(to) - potential_[from] + potential_[to];
+                result.route = engine.template route<route_t>(to);
+            }
+        });
+
+        return results;
+    }
+
+    /*!
+     * \brief Кратчайший путь между ключами, как у dijkstra()
+     */
+    template<typename route_t, typename node_type_t>
+    std::pair<weight_type, route_t> query(const node_type_t& key_from, const node_type_t& key_to) {
+        id_type from = graph_->at(key_from);
+        id_type to = graph_->at(key_to);
+
+        DijkstraEngine<ReweightedGraph<csr_t>>& engine = *engines_[0];
+        if (!engine.run(from, to)) {
+            throw std::logic_error("no route.\n");
+        }
+
+        return std::pair<weight_type, route_t>(engine.distance(to) - potential_[from] + potential_[to],
+                                               engine.template route<route_t>(to));
+    }
+};
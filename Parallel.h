@@ -0,0 +1,298 @@
+#pragma once
+
+#include <vector>
+#include <mutex>
+#include <atomic>
+#include <thread>
+#include <limits>
+#include <functional>
+#include <condition_variable>
+#include <iterator>
+#include <algorithm>
+#include <exception>
+
+
+/*!
+ * \brief Число рабочих потоков: 0 - по числу ядер, и не больше, чем есть работы
+ * @param items объём работы
+ * @param grain минимальная порция работы на один поток
+ */
+inline unsigned worker_count(unsigned threads, std::size_t items, std::size_t grain = 4096) {
+    if (threads == 0) {
+        threads = std::max(1u, std::thread::hardware_concurrency());
+    }
+
+    std::size_t useful = std::max<std::size_t>(1, items / std::max<std::size_t>(1, grain));
+    return static_cast<unsigned>(std::min<std::size_t>(threads, useful));
+}
+
+/*!
+ * \brief Многоразовый барьер для фиксированного числа потоков
+ *
+ * wait() возвращается, когда его вызвали все count потоков; сразу после этого
+ * барьер готов к следующему раунду. Поток, не способный продолжать (например,
+ * поймавший исключение), вызывает abort(): все ждущие и будущие wait() сразу
+ * возвращают false, и потоки должны выйти, не дожидаясь остальных.
+ */
+class Barrier {
+    std::mutex mutex_;
+    std::condition_variable wake_;
+    std::size_t count_;
+    std::size_t waiting_ = 0;
+    std::size_t round_ = 0;
+    bool aborted_ = false;
+
+public:
+    explicit Barrier(std::size_t count) : count_(count) {}
+
+    Barrier(const Barrier& other) = delete;
+
+    Barrier& operator=(const Barrier& rhs) = delete;
+
+    /*!
+     * \brief Дождаться остальных потоков
+     * @return false, если барьер прерван abort()
+     */
+    bool wait() {
+        std::unique_lock<std::mutex> lock(mutex_);
+        if (aborted_) {
+            return false;
+        }
+
+        std::size_t round = round_;
+
+        if (++waiting_ == count_) {
+            waiting_ = 0;
+            round_++;
+            wake_.notify_all();
+            return true;
+        }
+
+        wake_.wait(lock, [&] { return round_ != round || aborted_; });
+        return round_ != round;
+    }
+
+    void abort() {
+        std::lock_guard<std::mutex> lock(mutex_);
+        aborted_ = true;
+        wake_.notify_all();
+    }
+};
+
+/*!
+ * \brief Разбить [begin, end) на threads подряд идущих кусков и обработать их параллельно
+ *
+ * fn(part, lo, hi) вызывается по разу на кусок; part - номер куска. Первое
+ * исключение из рабочих потоков пробрасывается в вызывающий поток.
+ */
+template<typename function_t>
+void parallel_for(std::size_t begin, std::size_t end, unsigned threads, function_t fn) {
+    std::size_t count = end > begin ? end - begin : 0;
+    if (threads <= 1 || count <= 1) {
+        fn(0u, begin, end);
+        return;
+    }
+
+    threads = static_cast<unsigned>(std::min<std::size_t>(threads, count));
+
+    std::vector<std::thread> workers;
+    std::vector<std::exception_ptr> errors(threads);
+    workers.reserve(threads - 1);
+
+    auto run = [&](unsigned part) {
+        std::size_t lo = begin + count * part / threads;
+        std::size_t hi = begin + count * (part + 1) / threads;
+        try {
+            fn(part, lo, hi);
+        } catch (...) {
+            errors[part] = std::current_exception();
+        }
+    };
+
+    for (unsigned part = 1; part < threads; part++) {
+        workers.emplace_back(run, part);
+    }
+    run(0);
+
+    for (auto& worker : workers) {
+        worker.join();
+    }
+
+    for (auto& error : errors) {
+        if (error) {
+            std::rethrow_exception(error);
+        }
+    }
+}
+
+/*!
+ * \brief Устойчивая параллельная сортировка: куски сортируются независимо, затем попарно сливаются
+ */
+template<typename iterator_t, typename compare_t>
+void parallel_stable_sort(iterator_t first, iterator_t last, compare_t less, unsigned threads) {
+    std::size_t count = std::distance(first, last);
+    threads = worker_count(threads, count);
+
+    if (threads <= 1) {
+        std::stable_sort(first, last, less);
+        return;
+    }
+
+    std::vector<std::size_t> bounds(threads + 1);
+    for (unsigned part = 0; part <= threads; part++) {
+        bounds[part] = count * part / threads;
+    }
+
+    parallel_for(0, threads, threads, [&](unsigned, std::size_t lo, std::size_t hi) {
+        for (std::size_t part = lo; part < hi; part++) {
+            std::stable_sort(first + bounds[part], first + bounds[part + 1], less);
+        }
+    });
+
+    // слияния одного уровня независимы между собой
+    for (std::size_t width = 1; width < threads; width *= 2) {
+        std::size_t merges = (threads + 2 * width - 1) / (2 * width);
+        parallel_for(0, merges, static_cast<unsigned>(merges), [&](unsigned, std::size_t lo, std::size_t hi) {
+            for (std::size_t merge = lo; merge < hi; merge++) {
+                std::size_t left = merge * 2 * width;
+                std::size_t middle = std::min<std::size_t>(left + width, threads);
+                std::size_t right = std::min<std::size_t>(left + 2 * width, threads);
+                if (middle < right) {
+                    std::inplace_merge(first + bounds[left], first + bounds[middle], first + bounds[right], less);
+                }
+            }
+        });
+    }
+}
+
+/*!
+ * \brief Постоянный пул потоков для пакетов независимых задач
+ *
+ * run(count, fn) вызывает fn(worker, index) для каждого index из [0, count);
+ * индексы раздаются динамически, поэтому дорогие и дешёвые задачи
+ * распределяются ровно. worker из [0, size()) позволяет держать состояние
+ * на поток; вызывающий поток работает как worker 0.
+ */
+class ThreadPool {
+    std::vector<std::thread> workers_;
+    std::mutex mutex_;
+    std::mutex submit_;
+    std::condition_variable wake_;
+    std::condition_variable done_;
+
+    std::function<void(unsigned, std::size_t)> task_;
+    std::size_t count_ = 0;
+    std::atomic<std::size_t> next_{0};
+    std::size_t round_ = 0;
+    std::size_t active_ = 0;
+    std::exception_ptr error_;
+    bool stop_ = false;
+
+    void drain(unsigned worker) {
+        for (;;) {
+            std::size_t index = next_.fetch_add(1, std::memory_order_relaxed);
+            if (index >= count_) {
+                return;
+            }
+
+            try {
+                task_(worker, index);
+            } catch (...) {
+                std::lock_guard<std::mutex> lock(mutex_);
+                if (!error_) {
+                    error_ = std::current_exception();
+                }
+            }
+        }
+    }
+
+    void loop(unsigned worker) {
+        std::size_t seen = 0;
+
+        for (;;) {
+            {
+                std::unique_lock<std::mutex> lock(mutex_);
+                wake_.wait(lock, [&] { return stop_ || round_ != seen; });
+                if (stop_) {
+                    return;
+                }
+                seen = round_;
+            }
+
+            drain(worker);
+
+            std::lock_guard<std::mutex> lock(mutex_);
+            if (--active_ == 0) {
+                done_.notify_all();
+            }
+        }
+    }
+
+public:
+    /*!
+     * \param threads число потоков вместе с вызывающим, 0 - по числу ядер
+     */
+    explicit ThreadPool(unsigned threads = 0) {
+        threads = worker_count(threads, std::numeric_limits<std::size_t>::max(), 1);
+
+        workers_.reserve(threads - 1);
+        for (unsigned worker = 1; worker < threads; worker++) {
+            workers_.emplace_back(&ThreadPool::loop, this, worker);
+        }
+    }
+
+    ThreadPool(const ThreadPool& other) = delete;
+
+    ThreadPool& operator=(const ThreadPool& rhs) = delete;
+
+    ~ThreadPool() {
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            stop_ = true;
+        }
+        wake_.notify_all();
+
+        for (auto& worker : workers_) {
+            worker.join();
+        }
+    }
+
+    unsigned size() const {
+        return static_cast<unsigned>(workers_.size() + 1);
+    }
+
+    /*!
+     * \brief Выполнить fn(worker, index) для всех index и дождаться конца; первое исключение пробрасывается
+     *
+     * Пакеты от разных потоков выполняются по очереди.
+     */
+    template<typename function_t>
+    void run(std::size_t count, function_t fn) {
+        std::lock_guard<std::mutex> submit(submit_);
+
+        task_ = fn;
+        count_ = count;
+        next_.store(0, std::memory_order_relaxed);
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            error_ = nullptr;
+            active_ = workers_.size();
+            round_++;
+        }
+        wake_.notify_all();
+
+        drain(0);
+
+        std::exception_ptr error;
+        {
+            std::unique_lock<std::mutex> lock(mutex_);
+            done_.wait(lock, [&] { return active_ == 0; });
+            error = error_;
+        }
+
+        task_ = nullptr;
+        if (error) {
+            std::rethrow_exception(error);
+        }
+    }
+};
@@ -0,0 +1,172 @@
+#pragma once
+
+#include <map>
+#include <list>
+#include <memory>
+#include <utility>
+#include <stdexcept>
+#include <type_traits>
+#include "Dijkstra.h"
+#include "BatchQuery.h"
+
+
+/*!
+ * \brief LRU-кэш ответов dijkstra() для одного графа
+ *
+ * Ответы (в том числе "no route.") хранятся по паре (key_from, key_to). Кэш
+ * помнит graph.generation() на момент заполнения и при изменении графа
+ * сбрасывается целиком при следующем запросе; CSR-снимок тоже строится заново
+ * лишь после изменения. Обычные чтения (graph[key], at(), обход) кэш не
+ * сбрасывают. Граф должен пережить кэш и не переезжать в памяти.
+ * @tparam graph_t Graph
+ * @tparam route_t контейнер ключей маршрута
+ */
+template<typename graph_t, typename route_t>
+class ShortestPathCache {
+public:
+    typedef std::decay_t<decltype(std::declval<const graph_t&>().freeze())> csr_type;
+    typedef typename DijkstraEngine<csr_type>::weight_type weight_type;
+    typedef std::decay_t<decltype(std::declval<const csr_type&>().key(0))> key_type;
+
+private:
+    typedef std::pair<key_type, key_type> query_type;
+    typedef std::pair<query_type, PathResult<weight_type, route_t>> entry_type;
+
+    const graph_t* graph_;
+    std::size_t capacity_;
+    std::size_t generation_;
+
+    std::unique_ptr<csr_type> frozen_;
+    std::unique_ptr<DijkstraEngine<csr_type>> engine_;
+
+    // начало списка - недавно использованные
+    std::list<entry_type> entries_;
+    std::map<query_type, typename std::list<entry_type>::iterator> index_;
+
+    std::size_t hits_ = 0;
+    std::size_t misses_ = 0;
+
+    void refresh() {
+        if (generation_ != graph_->generation()) {
+            entries_.clear();
+            index_.clear();
+            engine_.reset();
+            frozen_.reset();
+            generation_ = graph_->generation();
+        }
+    }
+
+    PathResult<weight_type, route_t> compute(const key_type& key_from, const key_type& key_to) {
+        if (!frozen_) {
+            frozen_.reset(new csr_type(graph_->freeze()));
+            engine_.reset(new DijkstraEngine<csr_type>(*frozen_));
+        }
+
+        PathResult<weight_type, route_t> result;
+        auto from = frozen_->id(key_from);
+        auto to = frozen_->id(key_to);
+
+        if (from == csr_type::npos || to == csr_type::npos) {
+            result.status = query_status::no_node;
+            return result;
+        }
+
+        result.status = engine_->try_run(from, to);
+        if (result.status == query_status::ok) {
+            result.distance = engine_->distance(to);
+            result.route = engine_->template route<route_t>(to);
+        }
+
+        return result;
+    }
+
+public:
+    /*!
+     * \param capacity сколько последних ответов хранить
+     */
+    ShortestPathCache(const graph_t& graph, std::size_t capacity)
+            : graph_(&graph), capacity_(capacity), generation_(graph.generation()) {}
+
+    ShortestPathCache(const ShortestPathCache& other) = delete;
+
+    ShortestPathCache& operator=(const ShortestPathCache& rhs) = delete;
+
+    /*!
+     * \brief Ответ как у dijkstra(), из кэша, если граф с тех пор не менялся
+     */
+    std::pair<weight_type, route_t> query(const key_type& key_from, const key_type& key_to) {
+        const PathResult<weight_type, route_t>& result = lookup(key_from, key_to);
+
+        switch (result.status) {
+            case query_status::no_node:
+                throw std::logic_error("no such node.\n");
+            case query_status::no_route:
+                throw std::logic_error("no route.\n");
+            case query_status::negative_weight:
+                throw std::logic_error("negative weight.\n");
+            default:
+                return std::pair<weight_type, route_t>(result.distance, result.route);
+        }
+    }
+
+    /*!
+     * \brief Ответ со статусом вместо исключения; ссылка живёт до следующего запроса
+     */
+    const PathResult<weight_type, route_t>& lookup(const key_type& key_from, const key_type& key_to) {
+        refresh();
+
+        query_type key(key_from, key_to);
+        auto found = index_.find(key);
+        if (found != index_.end()) {
+            hits_++;
+            entries_.splice(entries_.begin(), entries_, found->second);
+            return found->second->second;
+        }
+
+        misses_++;
+        entries_.emplace_front(key, compute(key_from, key_to));
+        index_.emplace(key, entries_.begin());
+
+        // только что добавленный ответ вытеснять нельзя: на него возвращается ссылка
+        while (entries_.size() > capacity_ && entries_.size() > 1) {
+            index_.erase(entries_.back().first);
+            entries_.pop_back();
+        }
+
+        return entries_.front().second;
+    }
+
+    std::size_t size() const {
+        return entries_.size();
+    }
+
+    std::size_t capacity() const {
+        return capacity_;
+    }
+
+    void set_capacity(std::size_t capacity) {
+        capacity_ = capacity;
+        while (entries_.size() > capacity_) {
+            index_.erase(entries_.back().first);
+            entries_.pop_back();
+        }
+    }
+
+    std::size_t hits() const {
+        return hits_;
+    }
+
+    std::size_t misses() const {
+        return misses_;
+    }
+
+    void reset_counters() {
+        hits_ = 0;
+        misses_ = 0;
+    }
+
+    void clear() {
+        entries_.clear();
+        index_.clear();
+    }
+};
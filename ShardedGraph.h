@@ -0,0 +1,239 @@
+#pragma once
+
+#include <mutex>
+#include <tuple>
+#include <vector>
+#include <memory>
+#include <utility>
+#include <algorithm>
+#include <stdexcept>
+#include <functional>
+#include "Graph.h"
+
+
+/*!
+ * \brief Граф для параллельной загрузки: вершины разбиты по хешу ключа на шарды со своими мьютексами
+ *
+ * insert_node/insert_edge/insert_or_assign_edge можно вызывать из многих потоков:
+ * каждый вызов держит мьютекс только одного шарда, так что потоки мешают друг
+ * другу лишь при попадании в один шард. Вершины не удаляются, поэтому проверка
+ * существования конца ребра в другом шарде остаётся верной и после отпускания
+ * его мьютекса. По окончании загрузки граф переводится в Graph или CsrGraph.
+ * @tparam key_type
+ * @tparam value_type
+ * @tparam weight_type
+ * @tparam storage_type политика хранения (см. Storage.h)
+ * @tparam hash_type
+ */
+template<typename key_type, typename value_type, typename weight_type, typename storage_type = map_storage,
+        typename hash_type = std::hash<key_type>>
+class ShardedGraph {
+public:
+    typedef Graph<key_type, value_type, weight_type, storage_type> graph_type;
+    typedef CsrGraph<key_type, value_type, weight_type> snapshot_type;
+
+private:
+    struct ShardNode {
+        value_type val;
+        typename storage_type::template edge_table<key_type, weight_type> edges;
+    };
+
+    // по строке кэша на шард, чтобы мьютексы соседних шардов не делили линию
+    struct alignas(64) Shard {
+        mutable std::mutex mutex;
+        typename storage_type::template node_table<key_type, ShardNode> nodes;
+        std::size_t edges = 0;
+    };
+
+    std::size_t shard_count_;
+    std::unique_ptr<Shard[]> shards_;
+    hash_type hash_;
+
+    Shard& shard(const key_type& key) {
+        return shards_[hash_(key) * 0x9E3779B97F4A7C15ull % shard_count_];
+    }
+
+    const Shard& shard(const key_type& key) const {
+        return shards_[hash_(key) * 0x9E3779B97F4A7C15ull % shard_count_];
+    }
+
+    template<typename function_t>
+    void for_each_shard_locked(function_t fn) const {
+        std::vector<std::unique_lock<std::mutex>> locks;
+        locks.reserve(shard_count_);
+        for (std::size_t i = 0; i < shard_count_; i++) {
+            locks.emplace_back(shards_[i].mutex);
+        }
+
+        for (std::size_t i = 0; i < shard_count_; i++) {
+            fn(shards_[i]);
+        }
+    }
+
+    template<bool assign>
+    bool put_edge(const key_type& key_from, const key_type& key_to, const weight_type& weight) {
+        if (!contains(key_to)) {
+            throw std::logic_error("second node is absent\n");
+        }
+
+        Shard& from = shard(key_from);
+        std::lock_guard<std::mutex> lock(from.mutex);
+
+        auto found = from.nodes.find(key_from);
+        if (found == from.nodes.end()) {
+            throw std::logic_error("first node is absent\n");
+        }
+
+        auto& edges = found->second.edges;
+        std::size_t before = edges.size();
+        if (assign) {
+            edges.insert_or_assign(key_to, weight);
+        } else {
+            edges.try_emplace(key_to, weight);
+        }
+
+        bool inserted = edges.size() != before;
+        from.edges += inserted;
+        return inserted;
+    }
+
+public:
+    /*!
+     * \param shards число шардов; имеет смысл брать в несколько раз больше числа потоков
+     */
+    explicit ShardedGraph(std::size_t shards = 64) : shard_count_(std::max<std::size_t>(1, shards)),
+                                                     shards_(new Shard[shard_count_]) {}
+
+    ShardedGraph(const ShardedGraph& other) = delete;
+
+    ShardedGraph& operator=(const ShardedGraph& rhs) = delete;
+
+    std::size_t shard_count() const {
+        return shard_count_;
+    }
+
+    bool contains(const key_type& key) const {
+        const Shard& s = shard(key);
+        std::lock_guard<std::mutex> lock(s.mutex);
+        return s.nodes.find(key) != s.nodes.end();
+    }
+
+    std::size_t size() const {
+        std::size_t result = 0;
+        for_each_shard_locked([&](const Shard& s) { result += s.nodes.size(); });
+        return result;
+    }
+
+    std::size_t edge_count() const {
+        std::size_t result = 0;
+        for_each_shard_locked([&](const Shard& s) { result += s.edges; });
+        return result;
+    }
+
+    /*!
+     * \brief Как Graph::insert_node: значение уже имеющейся вершины не меняется
+     * @return true, если вершина добавлена
+     */
+    bool insert_node(const key_type& key, const value_type& val) {
+        Shard& s = shard(key);
+        std::lock_guard<std::mutex> lock(s.mutex);
+        return s.nodes.try_emplace(key, ShardNode{val, {}}).second;
+    }
+
+    bool insert_or_assign_node(const key_type& key, const value_type& val) {
+        Shard& s = shard(key);
+        std::lock_guard<std::mutex> lock(s.mutex);
+
+        auto found = s.nodes.find(key);
+        if (found != s.nodes.end()) {
+            found->second.val = val;
+            return false;
+        }
+
+        s.nodes.try_emplace(key, ShardNode{val, {}});
+        return true;
+    }
+
+    /*!
+     * \brief Как Graph::insert_edge: оба конца должны существовать, имеющееся ребро не меняется
+     * @return true, если ребро добавлено
+     */
+    bool insert_edge(std::pair<key_type, key_type> keys, const weight_type& weight) {
+        return put_edge<false>(keys.first, keys.second, weight);
+    }
+
+    bool insert_or_assign_edge(std::pair<key_type, key_type> keys, const weight_type& weight) {
+        return put_edge<true>(keys.first, keys.second, weight);
+    }
+
+    /*!
+     * \brief Обычный Graph с тем же содержимым (строится через bulk_insert)
+     * @param threads число потоков, 0 - по числу ядер
+     */
+    graph_type to_graph(unsigned threads = 0) const {
+        std::vector<std::pair<key_type, value_type>> nodes;
+        std::vector<std::tuple<key_type, key_type, weight_type>> edges;
+
+        for_each_shard_locked([&](const Shard& s) {
+            for (const auto& [key, node] : s.nodes) {
+                nodes.emplace_back(key, node.val);
+                for (const auto& [to, weight] : node.edges) {
+                    edges.emplace_back(key, to, weight);
+                }
+            }
+        });
+
+        graph_type result;
+        result.bulk_insert(nodes, edges, edge_conflict::keep_first, threads);
+        return result;
+    }
+
+    /*!
+     * \brief CSR-снимок напрямую, без промежуточного Graph
+     * @param threads число потоков сортировки вершин, 0 - по числу ядер
+     */
+    snapshot_type freeze(unsigned threads = 0) const {
+        typedef typename snapshot_type::id_type id_type;
+
+        std::vector<std::pair<const key_type*, const ShardNode*>> nodes;
+        std::vector<key_type> keys;
+        std::vector<value_type> values;
+        std::vector<std::size_t> offsets;
+        std::vector<id_type> targets;
+        std::vector<weight_type> weights;
+
+        for_each_shard_locked([&](const Shard& s) {
+            for (const auto& [key, node] : s.nodes) {
+                nodes.emplace_back(&key, &node);
+            }
+        });
+
+        if (nodes.size() >= snapshot_type::npos) {
+            throw std::length_error("too many nodes for csr graph.\n");
+        }
+
+        parallel_stable_sort(nodes.begin(), nodes.end(),
+                             [](const auto& lhs, const auto& rhs) { return *lhs.first < *rhs.first; }, threads);
+
+        keys.reserve(nodes.size());
+        values.reserve(nodes.size());
+        for (const auto& [key, node] : nodes) {
+            keys.push_back(*key);
+            values.push_back(node->val);
+        }
+
+        offsets.reserve(nodes.size() + 1);
+        offsets.push_back(0);
+        for (const auto& [key, node] : nodes) {
+            for (const auto& [to, weight] : node->edges) {
+                auto it = std::lower_bound(keys.begin(), keys.end(), to);
+                targets.push_back(static_cast<id_type>(it - keys.begin()));
+                weights.push_back(weight);
+            }
+            offsets.push_back(targets.size());
+        }
+
+        return snapshot_type(std::move(keys), std::move(values), std::move(offsets), std::move(targets),
+                             std::move(weights));
+    }
+};
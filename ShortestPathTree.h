@@ -0,0 +1,131 @@
+#pragma once
+
+#include <vector>
+#include <memory>
+#include <utility>
+#include <algorithm>
+#include <stdexcept>
+#include <type_traits>
+
+
+/*!
+ * \brief Дерево кратчайших путей из одного источника: расстояние и предок каждой вершины
+ *
+ * Считается один раз, а маршруты до любых целей разворачиваются лениво по
+ * цепочке предков. Вершина достижима, если это источник или у неё есть предок.
+ * @tparam csr_t CsrGraph или совместимое представление
+ * @tparam distance_type тип расстояний: по умолчанию тип весов, для BFS - число рёбер
+ */
+template<typename csr_t, typename distance_type = std::decay_t<decltype(std::declval<const csr_t&>().weight(0))>>
+class ShortestPathTree {
+public:
+    typedef typename csr_t::id_type id_type;
+    typedef distance_type weight_type;
+
+    static constexpr id_type npos = csr_t::npos;
+
+private:
+    const csr_t* graph_ = nullptr;
+    std::shared_ptr<const csr_t> owner_;
+    id_type source_ = npos;
+    std::vector<weight_type> dist_;
+    std::vector<id_type> parent_;
+
+public:
+    ShortestPathTree() = default;
+
+    /*!
+     * \brief Дерево над graph, который должен пережить дерево
+     */
+    ShortestPathTree(const csr_t& graph, id_type source, std::vector<weight_type> dist, std::vector<id_type> parent)
+            : graph_(&graph), source_(source), dist_(std::move(dist)), parent_(std::move(parent)) {
+        if (dist_.size() != graph.size() || parent_.size() != graph.size()) {
+            throw std::logic_error("tree does not match the graph.\n");
+        }
+    }
+
+    /*!
+     * \brief То же дерево, но совместно владеющее снимком графа, над которым оно построено
+     */
+    ShortestPathTree(std::shared_ptr<const csr_t> graph, ShortestPathTree tree) : ShortestPathTree(std::move(tree)) {
+        if (graph.get() != graph_) {
+            throw std::logic_error("tree does not match the graph.\n");
+        }
+
+        owner_ = std::move(graph);
+    }
+
+    const csr_t& graph() const {
+        return *graph_;
+    }
+
+    id_type source() const {
+        return source_;
+    }
+
+    bool reachable(id_type id) const {
+        return id == source_ || parent_[id] != npos;
+    }
+
+    const weight_type& distance(id_type id) const {
+        return dist_[id];
+    }
+
+    id_type parent(id_type id) const {
+        return parent_[id];
+    }
+
+    template<typename node_type_t>
+    bool reaches(const node_type_t& key) const {
+        id_type id = graph_->id(key);
+        return id != npos && reachable(id);
+    }
+
+    /*!
+     * \brief Расстояние до вершины; для недостижимой - исключение "no route."
+     */
+    template<typename node_type_t>
+    const weight_type& distance_to(const node_type_t& key) const {
+        id_type id = graph_->at(key);
+        if (!reachable(id)) {
+            throw std::logic_error("no route.\n");
+        }
+
+        return dist_[id];
+    }
+
+    template<typename route_t>
+    route_t route(id_type target) const {
+        route_t result;
+
+        for (id_type v = target; v != npos; v = parent_[v]) {
+            result.push_back(graph_->key(v));
+        }
+
+        std::reverse(result.begin(), result.end());
+        return result;
+    }
+
+    template<typename route_t, typename node_type_t>
+    route_t route_to(const node_type_t& key) const {
+        id_type id = graph_->at(key);
+        if (!reachable(id)) {
+            throw std::logic_error("no route.\n");
+        }
+
+        return route<route_t>(id);
+    }
+
+    /*!
+     * \brief Длина и маршрут до цели, как у dijkstra() из источника дерева
+     */
+    template<typename route_t, typename node_type_t>
+    std::pair<weight_type, route_t> query(const node_type_t& key) const {
+        id_type id = graph_->at(key);
+        if (!reachable(id)) {
+            throw std::logic_error("no route.\n");
+        }
+
+        return std::pair<weight_type, route_t>(dist_[id], route<route_t>(id));
+    }
+};
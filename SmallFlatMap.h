@@ -0,0 +1,354 @@
+#pragma once
+
+#include <memory>
+#include <utility>
+#include <tuple>
+#include <cstdint>
+#include <iterator>
+#include <algorithm>
+#include <stdexcept>
+#include <functional>
+
+
+/*!
+ * \brief Отсортированный плоский массив пар со встроенным буфером на inline_capacity элементов
+ *
+ * Пока элементов не больше inline_capacity, память в куче не выделяется вовсе;
+ * больше - массив переезжает в кучу. Итераторы - обычные указатели, поэтому
+ * обход линейный по памяти. Вставка и удаление сдвигают хвост: O(size()).
+ * @tparam key_type
+ * @tparam mapped_type
+ * @tparam inline_capacity
+ * @tparam compare_type
+ * @tparam allocator_t распределитель массива в куче; новые элементы создаются через него
+ */
+template<typename key_type, typename mapped_type, std::size_t inline_capacity = 8,
+        typename compare_type = std::less<key_type>,
+        typename allocator_t = std::allocator<std::pair<const key_type, mapped_type>>>
+class SmallFlatMap {
+public:
+    typedef std::pair<const key_type, mapped_type> value_type;
+    typedef value_type* iterator;
+    typedef const value_type* const_iterator;
+    typedef allocator_t allocator_type;
+
+private:
+    static_assert(inline_capacity > 0, "inline capacity must be positive");
+
+    typedef std::allocator_traits<allocator_type> traits;
+
+    alignas(value_type) unsigned char buffer_[inline_capacity * sizeof(value_type)];
+    value_type* data_ = reinterpret_cast<value_type*>(buffer_);
+    std::size_t size_ = 0;
+    std::size_t capacity_ = inline_capacity;
+
+    compare_type less_;
+    allocator_type alloc_;
+
+    bool is_inline() const {
+        return data_ == reinterpret_cast<const value_type*>(buffer_);
+    }
+
+    // ключ константный, поэтому "присваивание" элемента - это разрушение и повторное создание
+    static void relocate(value_type* to, value_type* from) {
+        ::new (static_cast<void*>(to)) value_type(std::move(*from));
+        from->~value_type();
+    }
+
+    void destroy_all() {
+        for (std::size_t i = 0; i < size_; i++) {
+            traits::destroy(alloc_, data_ + i);
+        }
+        size_ = 0;
+    }
+
+    void release() {
+        destroy_all();
+        if (!is_inline()) {
+            traits::deallocate(alloc_, data_, capacity_);
+            data_ = reinterpret_cast<value_type*>(buffer_);
+            capacity_ = inline_capacity;
+        }
+    }
+
+    void grow(std::size_t capacity) {
+        value_type* data = traits::allocate(alloc_, capacity);
+        for (std::size_t i = 0; i < size_; i++) {
+            relocate(data + i, data_ + i);
+        }
+
+        if (!is_inline()) {
+            traits::deallocate(alloc_, data_, capacity_);
+        }
+
+        data_ = data;
+        capacity_ = capacity;
+    }
+
+    value_type* lower_bound(const key_type& key) const {
+        return std::lower_bound(data_, data_ + size_, key, [this](const value_type& item, const key_type& k) {
+            return less_(item.first, k);
+        });
+    }
+
+    bool matches(const value_type* position, const key_type& key) const {
+        return position != data_ + size_ && !less_(key, position->first);
+    }
+
+    // забрать содержимое other; сам объект должен быть пуст и во встроенном буфере
+    void steal(SmallFlatMap& other) {
+        if (!(alloc_ == other.alloc_)) {
+            // чужую память забрать нельзя: элементы пересоздаются своим распределителем
+            reserve(other.size_);
+            for (std::size_t i = 0; i < other.size_; i++) {
+                traits::construct(alloc_, data_ + i, std::move(other.data_[i]));
+                size_++;
+            }
+            other.release();
+            return;
+        }
+
+        if (other.is_inline()) {
+            for (std::size_t i = 0; i < other.size_; i++) {
+                relocate(data_ + i, other.data_ + i);
+            }
+            size_ = other.size_;
+            other.size_ = 0;
+            return;
+        }
+
+        data_ = other.data_;
+        size_ = other.size_;
+        capacity_ = other.capacity_;
+
+        other.data_ = reinterpret_cast<value_type*>(other.buffer_);
+        other.size_ = 0;
+        other.capacity_ = inline_capacity;
+    }
+
+    template<typename... args_t>
+    iterator emplace_at(std::size_t index, const key_type& key, args_t&&... args) {
+        if (size_ == capacity_) {
+            grow(capacity_ * 2);
+        }
+
+        for (std::size_t i = size_; i > index; i--) {
+            relocate(data_ + i, data_ + i - 1);
+        }
+
+        traits::construct(alloc_, data_ + index, std::piecewise_construct, std::forward_as_tuple(key),
+                          std::forward_as_tuple(std::forward<args_t>(args)...));
+        size_++;
+
+        return data_ + index;
+    }
+
+public:
+    SmallFlatMap() = default;
+
+    explicit SmallFlatMap(const allocator_type& alloc) : alloc_(alloc) {}
+
+    SmallFlatMap(const SmallFlatMap& other)
+            : SmallFlatMap(other, traits::select_on_container_copy_construction(other.alloc_)) {}
+
+    SmallFlatMap(const SmallFlatMap& other, const allocator_type& alloc) : less_(other.less_), alloc_(alloc) {
+        reserve(other.size_);
+        for (std::size_t i = 0; i < other.size_; i++) {
+            traits::construct(alloc_, data_ + i, other.data_[i]);
+            size_++;
+        }
+    }
+
+    SmallFlatMap(SmallFlatMap&& other) noexcept : less_(other.less_), alloc_(other.alloc_) {
+        steal(other);
+    }
+
+    SmallFlatMap(SmallFlatMap&& other, const allocator_type& alloc) : less_(other.less_), alloc_(alloc) {
+        steal(other);
+    }
+
+    SmallFlatMap& operator=(const SmallFlatMap& rhs) {
+        if (this != &rhs) {
+            SmallFlatMap tmp(rhs, traits::propagate_on_container_copy_assignment::value ? rhs.alloc_ : alloc_);
+            *this = std::move(tmp);
+        }
+
+        return *this;
+    }
+
+    SmallFlatMap& operator=(SmallFlatMap&& rhs) noexcept(traits::propagate_on_container_move_assignment::value ||
+                                                         traits::is_always_equal::value) {
+        if (this != &rhs) {
+            release();
+            if constexpr (traits::propagate_on_container_move_assignment::value) {
+                alloc_ = rhs.alloc_;
+            }
+            less_ = rhs.less_;
+            steal(rhs);
+        }
+
+        return *this;
+    }
+
+    ~SmallFlatMap() {
+        release();
+    }
+
+    bool empty() const {
+        return size_ == 0;
+    }
+
+    std::size_t size() const {
+        return size_;
+    }
+
+    std::size_t capacity() const {
+        return capacity_;
+    }
+
+    allocator_type get_allocator() const {
+        return alloc_;
+    }
+
+    void clear() {
+        release();
+    }
+
+    void reserve(std::size_t count) {
+        if (count > capacity_) {
+            grow(count);
+        }
+    }
+
+    iterator begin() {
+        return data_;
+    }
+
+    iterator end() {
+        return data_ + size_;
+    }
+
+    const_iterator begin() const {
+        return data_;
+    }
+
+    const_iterator end() const {
+        return data_ + size_;
+    }
+
+    const_iterator cbegin() const {
+        return data_;
+    }
+
+    const_iterator cend() const {
+        return data_ + size_;
+    }
+
+    iterator find(const key_type& key) {
+        value_type* position = lower_bound(key);
+        return matches(position, key) ? position : end();
+    }
+
+    const_iterator find(const key_type& key) const {
+        value_type* position = lower_bound(key);
+        return matches(position, key) ? position : end();
+    }
+
+    std::size_t count(const key_type& key) const {
+        return find(key) != end() ? 1 : 0;
+    }
+
+    mapped_type& at(const key_type& key) {
+        iterator it = find(key);
+        if (it == end()) {
+            throw std::out_of_range("no such key.\n");
+        }
+
+        return it->second;
+    }
+
+    const mapped_type& at(const key_type& key) const {
+        const_iterator it = find(key);
+        if (it == end()) {
+            throw std::out_of_range("no such key.\n");
+        }
+
+        return it->second;
+    }
+
+    template<typename... args_t>
+    std::pair<iterator, bool> try_emplace(const key_type& key, args_t&&... args) {
+        value_type* position = lower_bound(key);
+        if (matches(position, key)) {
+            return std::pair<iterator, bool>(position, false);
+        }
+
+        return std::pair<iterator, bool>(emplace_at(position - data_, key, std::forward<args_t>(args)...), true);
+    }
+
+    template<typename value_t>
+    std::pair<iterator, bool> emplace(const key_type& key, value_t&& value) {
+        return try_emplace(key, std::forward<value_t>(value));
+    }
+
+    std::pair<iterator, bool> insert(const value_type& value) {
+        return try_emplace(value.first, value.second);
+    }
+
+    template<typename value_t>
+    std::pair<iterator, bool> insert_or_assign(const key_type& key, value_t&& value) {
+        auto result = try_emplace(key, std::forward<value_t>(value));
+        if (!result.second) {
+            result.first->second = std::forward<value_t>(value);
+        }
+
+        return result;
+    }
+
+    /*!
+     * \brief Вставка с подсказкой: при hint == end() и ключе больше всех имеющихся - за O(1)
+     */
+    template<typename... args_t>
+    iterator try_emplace(const_iterator hint, const key_type& key, args_t&&... args) {
+        if (hint == end() && (size_ == 0 || less_(data_[size_ - 1].first, key))) {
+            return emplace_at(size_, key, std::forward<args_t>(args)...);
+        }
+
+        return try_emplace(key, std::forward<args_t>(args)...).first;
+    }
+
+    template<typename value_t>
+    iterator insert_or_assign(const_iterator hint, const key_type& key, value_t&& value) {
+        if (hint == end() && (size_ == 0 || less_(data_[size_ - 1].first, key))) {
+            return emplace_at(size_, key, std::forward<value_t>(value));
+        }
+
+        return insert_or_assign(key, std::forward<value_t>(value)).first;
+    }
+
+    mapped_type& operator[](const key_type& key) {
+        return try_emplace(key).first->second;
+    }
+
+    iterator erase(const_iterator position) {
+        std::size_t index = position - data_;
+
+        traits::destroy(alloc_, data_ + index);
+        for (std::size_t i = index + 1; i < size_; i++) {
+            relocate(data_ + i - 1, data_ + i);
+        }
+        size_--;
+
+        return data_ + index;
+    }
+
+    std::size_t erase(const key_type& key) {
+        iterator it = find(key);
+        if (it == end()) {
+            return 0;
+        }
+
+        erase(it);
+        return 1;
+    }
+};
@@ -0,0 +1,76 @@
+#pragma once
+
+#include <map>
+#include <memory_resource>
+#include "FlatHashMap.h"
+#include "SmallFlatMap.h"
+
+
+/*!
+ * \brief Политика хранения графа: таблица вершин и таблица рёбер каждой вершины
+ *
+ * Обе таблицы должны поддерживать то подмножество интерфейса std::map, которым
+ * пользуется Graph (find, insert, emplace, insert_or_assign, erase, at, operator[]
+ * и итерацию по парам (ключ, значение)).
+ */
+template<template<typename, typename> class node_table_t, template<typename, typename> class edge_table_t>
+struct storage_policy {
+    template<typename key_type, typename node_type>
+    using node_table = node_table_t<key_type, node_type>;
+
+    template<typename key_type, typename weight_type>
+    using edge_table = edge_table_t<key_type, weight_type>;
+};
+
+template<typename key_type, typename mapped_type>
+using ordered_table = std::map<key_type, mapped_type>;
+
+template<typename key_type, typename mapped_type>
+using flat_hash_table = FlatHashMap<key_type, mapped_type>;
+
+template<typename key_type, typename mapped_type>
+using small_flat_table = SmallFlatMap<key_type, mapped_type, 8>;
+
+/*!
+ * \brief std::map для вершин и рёбер (по умолчанию): обход в порядке ключей
+ */
+typedef storage_policy<ordered_table, ordered_table> map_storage;
+
+/*!
+ * \brief Открытая адресация для вершин и рёбер: поиск за O(1), обход в порядке хеша.
+ * Вставка вершины может переместить остальные вершины в памяти.
+ */
+typedef storage_policy<flat_hash_table, flat_hash_table> hash_storage;
+
+typedef storage_policy<flat_hash_table, ordered_table> hash_node_storage;
+
+typedef storage_policy<ordered_table, flat_hash_table> hash_edge_storage;
+
+/*!
+ * \brief Рёбра в отсортированном массиве со встроенным местом под 8 рёбер:
+ * у вершин малой степени рёбра не требуют ни одного выделения памяти
+ */
+typedef storage_policy<ordered_table, small_flat_table> small_edge_storage;
+
+typedef storage_policy<flat_hash_table, small_flat_table> hash_small_edge_storage;
+
+template<typename key_type, typename mapped_type>
+using pmr_ordered_table = std::pmr::map<key_type, mapped_type>;
+
+template<typename key_type, typename mapped_type>
+using pmr_flat_hash_table = FlatHashMap<key_type, mapped_type, std::hash<key_type>, std::equal_to<key_type>,
+        std::pmr::polymorphic_allocator<std::pair<const key_type, mapped_type>>>;
+
+template<typename key_type, typename mapped_type>
+using pmr_small_flat_table = SmallFlatMap<key_type, mapped_type, 8, std::less<key_type>,
+        std::pmr::polymorphic_allocator<std::pair<const key_type, mapped_type>>>;
+
+/*!
+ * \brief Как map_storage, но вся память вершин и рёбер берётся из memory_resource,
+ * переданного графу (см. Graph(std::pmr::memory_resource*) и ArenaGraph)
+ */
+typedef storage_policy<pmr_ordered_table, pmr_ordered_table> pmr_storage;
+
+typedef storage_policy<pmr_flat_hash_table, pmr_flat_hash_table> pmr_hash_storage;
+
+typedef storage_policy<pmr_ordered_table, pmr_small_flat_table> pmr_small_edge_storage;
@@ -0,0 +1,228 @@
+#pragma once
+
+#include <vector>
+#include <string>
+#include <string_view>
+#include <memory>
+#include <mutex>
+#include <limits>
+#include <cstdint>
+#include <cstring>
+#include <functional>
+#include <stdexcept>
+#include <ostream>
+
+
+/*!
+ * \brief Пул строк: каждая различная строка хранится один раз и получает плотный id
+ *
+ * Символы лежат в неперемещаемых блоках, поэтому string_view, выданные str(),
+ * остаются валидными всё время жизни пула. Поиск id - открытая адресация с
+ * линейным пробированием. Пустая строка всегда имеет id empty_id.
+ */
+class StringPool {
+public:
+    typedef std::uint32_t id_type;
+
+    static constexpr id_type npos = std::numeric_limits<id_type>::max();
+
+    static constexpr id_type empty_id = 0;
+
+private:
+    static constexpr std::size_t chunk_size = 64 * 1024;
+
+    std::vector<std::unique_ptr<char[]>> chunks_;
+    std::size_t chunk_used_ = chunk_size;
+
+    std::vector<std::string_view> strings_;
+    std::vector<std::size_t> hashes_;
+    std::vector<id_type> slots_;
+
+    static std::size_t hash(std::string_view str) {
+        return std::hash<std::string_view>()(str);
+    }
+
+    std::string_view store(std::string_view str) {
+        if (str.empty()) {
+            return std::string_view();
+        }
+
+        if (str.size() > chunk_size) {
+            // отдельный блок встаёт перед текущим, чтобы короткие строки продолжали заполнять текущий
+            auto place = chunks_.insert(chunks_.empty() ? chunks_.end() : chunks_.end() - 1,
+                                        std::unique_ptr<char[]>(new char[str.size()]));
+            std::memcpy(place->get(), str.data(), str.size());
+            return std::string_view(place->get(), str.size());
+        }
+
+        if (chunk_used_ + str.size() > chunk_size) {
+            chunks_.emplace_back(new char[chunk_size]);
+            chunk_used_ = 0;
+        }
+
+        char* place = chunks_.back().get() + chunk_used_;
+        std::memcpy(place, str.data(), str.size());
+        chunk_used_ += str.size();
+
+        return std::string_view(place, str.size());
+    }
+
+    std::size_t slot(std::string_view str, std::size_t h) const {
+        std::size_t mask = slots_.size() - 1;
+
+        for (std::size_t i = h & mask;; i = (i + 1) & mask) {
+            id_type id = slots_[i];
+            if (id == npos || (hashes_[id] == h && strings_[id] == str)) {
+                return i;
+            }
+        }
+    }
+
+    void grow() {
+        std::vector<id_type> old(slots_.empty() ? 16 : slots_.size() * 2, npos);
+        slots_.swap(old);
+
+        std::size_t mask = slots_.size() - 1;
+        for (id_type id = 0; id < strings_.size(); id++) {
+            std::size_t i = hashes_[id] & mask;
+            while (slots_[i] != npos) {
+                i = (i + 1) & mask;
+            }
+            slots_[i] = id;
+        }
+    }
+
+public:
+    StringPool() {
+        grow();
+        intern(std::string_view());
+    }
+
+    StringPool(const StringPool& other) = delete;
+
+    StringPool& operator=(const StringPool& rhs) = delete;
+
+    std::size_t size() const {
+        return strings_.size();
+    }
+
+    /*!
+     * \brief id строки; если строки ещё нет в пуле, она добавляется
+     */
+    id_type intern(std::string_view str) {
+        std::size_t h = hash(str);
+        std::size_t i = slot(str, h);
+        if (slots_[i] != npos) {
+            return slots_[i];
+        }
+
+        if (strings_.size() + 1 >= npos) {
+            throw std::length_error("string pool is full.\n");
+        }
+
+        id_type id = static_cast<id_type>(strings_.size());
+        strings_.push_back(store(str));
+        hashes_.push_back(h);
+
+        // заполненность не больше 1/2
+        if (2 * strings_.size() > slots_.size()) {
+            grow();
+        } else {
+            slots_[i] = id;
+        }
+
+        return id;
+    }
+
+    /*!
+     * \brief id строки без добавления, npos если её нет
+     */
+    id_type find(std::string_view str) const {
+        return slots_[slot(str, hash(str))];
+    }
+
+    std::string_view str(id_type id) const {
+        return strings_[id];
+    }
+};
+
+
+/*!
+ * \brief Интернированный строковый ключ: внутри только 4-байтовый id глобального пула
+ *
+ * Graph<Symbol, ...> хранит в рёбрах и сравнивает целые числа вместо строк,
+ * строка нужна лишь на границе API (str(), вывод в поток). Порядок Symbol -
+ * порядок интернирования, а не лексикографический.
+ */
+class Symbol {
+    StringPool::id_type id_;
+
+    static StringPool& pool() {
+        static StringPool instance;
+        return instance;
+    }
+
+    static std::mutex& pool_mutex() {
+        static std::mutex instance;
+        return instance;
+    }
+
+    static StringPool::id_type intern(std::string_view str) {
+        std::lock_guard<std::mutex> lock(pool_mutex());
+        return pool().intern(str);
+    }
+
+public:
+    /*!
+     * \brief Пустая строка; id зарезервирован в пуле, так что мьютекс не берётся
+     */
+    Symbol() : id_(StringPool::empty_id) {}
+
+    Symbol(std::string_view str) : id_(intern(str)) {}
+
+    Symbol(const std::string& str) : id_(intern(str)) {}
+
+    Symbol(const char* str) : id_(intern(str)) {}
+
+    StringPool::id_type id() const {
+        return id_;
+    }
+
+    std::string_view str() const {
+        std::lock_guard<std::mutex> lock(pool_mutex());
+        return pool().str(id_);
+    }
+
+    /*!
+     * \brief Проверка, интернирована ли строка (пул при этом не растёт)
+     */
+    static bool interned(std::string_view str) {
+        std::lock_guard<std::mutex> lock(pool_mutex());
+        return pool().find(str) != StringPool::npos;
+    }
+
+    friend bool operator==(Symbol lhs, Symbol rhs) {
+        return lhs.id_ == rhs.id_;
+    }
+
+    friend bool operator!=(Symbol lhs, Symbol rhs) {
+        return lhs.id_ != rhs.id_;
+    }
+
+    friend bool operator<(Symbol lhs, Symbol rhs) {
+        return lhs.id_ < rhs.id_;
+    }
+
+    friend std::ostream& operator<<(std::ostream& out, Symbol symbol) {
+        return out << symbol.str();
+    }
+};
+
+namespace std {
+    template<>
+    struct hash<Symbol> {
+        size_t operator()(Symbol symbol) const noexcept {
+            return hash<StringPool::id_type>()(symbol.id());
+        }
+    };
+}
@@ -0,0 +1,150 @@
+#pragma once
+
+#include <mutex>
+#include <atomic>
+#include <memory>
+#include <cstdint>
+#include <utility>
+#include <type_traits>
+#include "Graph.h"
+
+
+/*!
+ * \brief Граф для одновременных чтений и изменений: читатели работают с неизменяемыми версиями
+ *
+ * Писатели по очереди (под мьютексом) меняют рабочую копию Graph и публикуют
+ * её CSR-снимок атомарной заменой shared_ptr. Читатель берёт текущую версию
+ * одной атомарной загрузкой и держит её, сколько нужно: долгий поиск не мешает
+ * изменениям, а изменения не видны ему до следующего snapshot(). Старая версия
+ * освобождается, когда её отпустит последний читатель.
+ *
+ * Публикация - это полный freeze() рабочей копии, O(V + E log V) на map_storage:
+ * одно изменённое ребро стоит столько же, сколько перестройка всего снимка.
+ * Поэтому публикации объединяются: писатели, пришедшие во время чужой
+ * публикации, дожидаются одной общей, а не строят снимок каждый. Серию
+ * изменений одного писателя выгоднее копить через update(fn, false) и
+ * публиковать одним publish().
+ * @tparam key_type
+ * @tparam value_type
+ * @tparam weight_type
+ * @tparam storage_type
+ */
+template<typename key_type, typename value_type, typename weight_type, typename storage_type = map_storage>
+class VersionedGraph {
+public:
+    typedef Graph<key_type, value_type, weight_type, storage_type> graph_type;
+    typedef CsrGraph<key_type, value_type, weight_type> snapshot_type;
+
+private:
+    struct Version {
+        std::uint64_t number;
+        snapshot_type graph;
+    };
+
+    // порядок захвата: publisher_, затем writer_
+    std::mutex publisher_;
+    std::mutex writer_;
+    graph_type master_;
+    std::shared_ptr<const Version> current_;
+
+    std::uint64_t edits_ = 0;     // под writer_: номер последнего изменения рабочей копии
+    std::uint64_t published_ = 0; // под publisher_: сколько изменений уже в опубликованной версии
+
+    // вызывается под publisher_ и writer_
+    void publish_locked() {
+        std::uint64_t number = std::atomic_load(&current_)->number + 1;
+        auto version = std::make_shared<const Version>(Version{number, master_.freeze()});
+        std::atomic_store(&current_, std::shared_ptr<const Version>(std::move(version)));
+        published_ = edits_;
+    }
+
+    // опубликовать версию, содержащую изменение edit; если его уже опубликовал другой писатель, снимок не строится
+    void publish_through(std::uint64_t edit) {
+        std::lock_guard<std::mutex> publishing(publisher_);
+        if (published_ >= edit) {
+            return;
+        }
+
+        std::lock_guard<std::mutex> lock(writer_);
+        publish_locked();
+    }
+
+public:
+    VersionedGraph() : current_(std::make_shared<const Version>(Version{0, snapshot_type()})) {}
+
+    explicit VersionedGraph(graph_type graph)
+            : master_(std::move(graph)), current_(std::make_shared<const Version>(Version{0, master_.freeze()})) {}
+
+    VersionedGraph(const VersionedGraph& other) = delete;
+
+    VersionedGraph& operator=(const VersionedGraph& rhs) = delete;
+
+    /*!
+     * \brief Текущая опубликованная версия; остаётся валидной, пока на неё есть ссылка
+     */
+    std::shared_ptr<const snapshot_type> snapshot() const {
+        std::shared_ptr<const Version> version = std::atomic_load(&current_);
+        return std::shared_ptr<const snapshot_type>(version, &version->graph);
+    }
+
+    /*!
+     * \brief Номер опубликованной версии: растёт на 1 с каждой публикацией
+     */
+    std::uint64_t version() const {
+        return std::atomic_load(&current_)->number;
+    }
+
+    /*!
+     * \brief Изменить граф: fn(Graph&) выполняется под мьютексом писателей
+     *
+     * Читатели при этом не блокируются. Если fn бросит исключение, уже сделанные
+     * им изменения останутся в рабочей копии и будут опубликованы следующим разом.
+     * Публикация ждёт своей очереди, не держа мьютекс писателей, поэтому
+     * писатели, пришедшие за время чужой публикации, успевают внести изменения
+     * и получают одну общую публикацию.
+     * @param publish к возврату опубликовать версию с этим изменением; false - копить изменения до publish()
+     * @return то, что вернула fn
+     */
+    template<typename function_t>
+    auto update(function_t fn, bool publish = true) {
+        std::unique_lock<std::mutex> lock(writer_);
+        std::uint64_t edit = ++edits_;
+
+        if constexpr (std::is_void<decltype(fn(master_))>::value) {
+            fn(master_);
+            lock.unlock();
+            if (publish) {
+                publish_through(edit);
+            }
+        } else {
+            auto result = fn(master_);
+            lock.unlock();
+            if (publish) {
+                publish_through(edit);
+            }
+            return result;
+        }
+    }
+
+    /*!
+     * \brief Опубликовать накопленные изменения, если они есть
+     */
+    void publish() {
+        std::lock_guard<std::mutex> publishing(publisher_);
+        std::lock_guard<std::mutex> lock(writer_);
+        if (published_ != edits_) {
+            publish_locked();
+        }
+    }
+
+    /*!
+     * \brief Кратчайший путь, как у dijkstra(), по текущей версии
+     */
+    template<typename route_t>
+    std::pair<weight_type, route_t> dijkstra(const key_type& key_from, const key_type& key_to) const {
+        auto graph = snapshot();
+        DijkstraEngine<snapshot_type> engine(*graph);
+
+        return engine.template query<route_t>(key_from, key_to);
+    }
+};
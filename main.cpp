@@ -1,6 +1,11 @@
 #include <iostream>
 #include <Matrix_file.h>
 #include <Graph.h>
+#include <DynamicShortestPaths.h>
+#include <fstream>
+#include <VersionedGraph.h>
+#include <ShardedGraph.h>
+#include <ArenaGraph.h>
 
 
 template<typename Graph>
@@ -19,6 +24,20 @@ void print(const Graph& graph) {
     }
 }
 
+// Граф для проверок: кратчайший путь 0 -> 2 -> 1 -> 3 -> 4 длины 11, вершина 5 без рёбер
+template<typename Graph>
+void fill_sample(Graph& graph) {
+    for (int key = 0; key < 6; key++) {
+        graph.insert_node(key, key);
+    }
+    graph.insert_edge({0, 1}, 4);
+    graph.insert_edge({0, 2}, 1);
+    graph.insert_edge({2, 1}, 2);
+    graph.insert_edge({1, 3}, 5);
+    graph.insert_edge({2, 3}, 8);
+    graph.insert_edge({3, 4}, 3);
+}
+
 
 int main() {/*
     Graph<int, int, int> graph;
@@ -193,5 +212,389 @@ int main() {/*
         std::cout << e.what() << "\n";
     }
 
-    return 0;
+    // Проверки: каждая печатает ok или FAIL, при сбое main возвращает 1
+    int failures = 0;
+    auto check = [&failures](bool passed, const std::string& what) {
+        std::cout << (passed ? "ok   " : "FAIL ") << what << std::endl;
+        failures += !passed;
+    };
+    auto throws = [](auto fn, const std::string& message) {
+        try { fn(); }
+        catch (const std::exception& e) { return message == e.what(); }
+        return false;
+    };
+
+    typedef vector<int> route_t;
+
+    {
+        Graph<int, int, double> sample;
+        fill_sample(sample);
+        auto frozen = sample.freeze();
+        check(frozen.size() == 6 && frozen.edge_count() == 6 && frozen.degree_out(frozen.at(2)) == 2, "freeze");
+        check(frozen.transpose().degree_out(frozen.at(1)) == 2, "freeze: transpose");
+        check(throws([&] { frozen.at(9); }, "no such node.\n"), "freeze: no node");
+    }
+
+    {
+        Graph<int, int, double> sample;
+        fill_sample(sample);
+        check(dijkstra<double, route_t>(sample, 0, 4) == pair<double, route_t>(11, {0, 2, 1, 3, 4}), "dijkstra");
+        check(throws([&] { dijkstra<double, route_t>(sample, 0, 5); }, "no route.\n"), "dijkstra: no route");
+        sample.insert_edge({3, 5}, -2);
+        check(throws([&] { dijkstra<double, route_t>(sample, 0, 1); }, "negative weight.\n"),
+              "dijkstra: negative weight past the target");
+    }
+
+    {
+        // с обратным индексом и без него графы должны вести себя одинаково
+        Graph<int, int, double> plain, indexed;
+        fill_sample(plain);
+        fill_sample(indexed);
+        indexed.enable_reverse_index();
+
+        auto same = [&] {
+            for (int key = 0; key < 6; key++) {
+                if (plain.contains(key) != indexed.contains(key) ||
+                    (plain.contains(key) && plain.degree_in(key) != indexed.degree_in(key))) {
+                    return false;
+                }
+            }
+
+            // incoming каждой вершины - ровно те вершины, из которых в неё есть ребро
+            for (const auto& [key, node] : indexed) {
+                set<int> sources;
+                for (const auto& [from, other] : indexed) {
+                    if (other.edges.count(key)) {
+                        sources.insert(from);
+                    }
+                }
+                if (sources != node.incoming) {
+                    return false;
+                }
+            }
+
+            return plain.freeze().targets() == indexed.freeze().targets();
+        };
+
+        check(same(), "reverse index: degree_in");
+        plain.insert_or_assign_edge({4, 1}, 1);
+        indexed.insert_or_assign_edge({4, 1}, 1);
+        check(same(), "reverse index: insert_or_assign_edge");
+        check(plain[2].erase_edge(1) && indexed[2].erase_edge(1) && same(), "reverse index: Node::erase_edge");
+        check(plain.erase_edges_go_to(3) && indexed.erase_edges_go_to(3) && same(), "reverse index: erase_edges_go_to");
+        check(plain.erase_node(1) && indexed.erase_node(1) && same(), "reverse index: erase_node");
+        plain.insert_edge({0, 3}, 1);
+        indexed.insert_edge({0, 3}, 1);
+        plain.clear_edges();
+        indexed.clear_edges();
+        check(same() && indexed.degree_in(3) == 0, "reverse index: clear_edges");
+        indexed.insert_edge({0, 3}, 1);
+        indexed.disable_reverse_index();
+        check(!indexed.reverse_index() && indexed.degree_in(3) == 1, "reverse index: disable");
+    }
+
+    {
+        StringPool pool;
+        pool.intern("first");
+        auto long_id = pool.intern(std::string(70000, 'x'));
+        auto short_id = pool.intern("hello-world");
+        check(pool.str(long_id) == std::string(70000, 'x') && pool.str(short_id) == "hello-world",
+              "string pool: oversized string");
+        check(pool.intern("hello-world") == short_id && pool.find("missing") == StringPool::npos, "string pool: intern");
+        check(Symbol() == Symbol("") && Symbol("abc").str() == "abc" && Symbol("abc") == Symbol(std::string("abc")),
+              "symbol");
+    }
+
+    // одни и те же проверки для каждой политики хранения
+    auto storage_checks = [&](auto graph, const std::string& what) {
+        fill_sample(graph);
+        graph.insert_node(6, 6);
+        check(graph.size() == 7 && !graph.insert_node(6, 0).second && graph.degree_out(2) == 2 &&
+              graph.degree_in(3) == 2, what + ": insert");
+        check(dijkstra<double, route_t>(graph, 0, 4) == pair<double, route_t>(11, {0, 2, 1, 3, 4}), what + ": dijkstra");
+        graph.insert_or_assign_edge({0, 1}, 0.5);
+        check(dijkstra<double, route_t>(graph, 0, 4).first == 8.5, what + ": insert_or_assign_edge");
+        check(graph.erase_node(1) && !graph.erase_node(1) && graph.degree_in(3) == 1, what + ": erase_node");
+        check(dijkstra<double, route_t>(graph, 0, 4).first == 12, what + ": dijkstra after erase");
+        graph.clear_edges();
+        check(graph.degree_out(0) == 0 && throws([&] { dijkstra<double, route_t>(graph, 0, 4); }, "no route.\n"),
+              what + ": clear_edges");
+    };
+
+    storage_checks(Graph<int, int, double>(), "map storage");
+    storage_checks(Graph<int, int, double, hash_storage>(), "hash storage");
+    storage_checks(Graph<int, int, double, small_edge_storage>(), "small edge storage");
+    storage_checks(Graph<int, int, double, hash_small_edge_storage>(), "hash small edge storage");
+
+    {
+        Graph<int, int, double> loaded;
+        size_t added = loaded.bulk_insert(vector<pair<int, int>>{{0, 0}, {1, 1}, {2, 2}},
+                                          vector<tuple<int, int, double>>{{0, 1, 1}, {1, 2, 2}, {0, 1, 5}, {2, 0, 3}});
+        check(added == 3 && loaded.size() == 3 && loaded.at(0).edges.at(1) == 1, "bulk_insert: keep first");
+        check(throws([&] { loaded.bulk_insert(vector<pair<int, int>>{}, vector<tuple<int, int, double>>{{0, 7, 1}}); },
+                     "second node is absent\n") && loaded.size() == 3, "bulk_insert: missing node");
+    }
+
+    {
+        Graph<int, int, double> sample;
+        fill_sample(sample);
+        check(bidirectional_dijkstra<double, route_t>(sample, 0, 4) == pair<double, route_t>(11, {0, 2, 1, 3, 4}),
+              "bidirectional_dijkstra");
+
+        // серия запросов: снимок и обратный граф строятся один раз
+        const auto forward = sample.freeze();
+        const auto backward = forward.transpose();
+        BidirectionalDijkstraEngine<decltype(forward)> engine(forward, backward);
+        check(engine.query<route_t>(0, 3).first == 8 && !engine.run(forward.at(4), forward.at(0)),
+              "bidirectional engine on prebuilt snapshots");
+    }
+
+    {
+        Graph<int, int, double> sample;
+        fill_sample(sample);
+        check(astar<double, route_t>(sample, 0, 4, [](int, int) { return 0.0; }).first == 11, "astar");
+
+        Graph<int, Point, double> plane;
+        plane.insert_node(0, {0, 0, 0});
+        plane.insert_node(1, {3, 4, 0});
+        plane.insert_node(2, {3, 0, 0});
+        plane.insert_edge({0, 1}, 6);
+        plane.insert_edge({0, 2}, 3);
+        plane.insert_edge({2, 1}, 4);
+        check(astar<double, route_t>(plane, 0, 1) == pair<double, route_t>(6, {0, 1}), "astar: euclidean heuristic");
+    }
+
+    {
+        Graph<int, int, double> sample;
+        fill_sample(sample);
+        auto hierarchy = contraction_hierarchy(sample);
+        sample.clear();
+        check(contraction_hierarchy_path<double, route_t>(hierarchy, 0, 4) == pair<double, route_t>(11, {0, 2, 1, 3, 4}),
+              "contraction_hierarchy_path");
+        check(throws([&] { contraction_hierarchy_path<double, route_t>(hierarchy, 0, 5); }, "no route.\n"),
+              "contraction_hierarchy_path: no route");
+    }
+
+    {
+        Graph<int, int, double> sample;
+        fill_sample(sample);
+        auto tree = shortest_path_tree(sample, 0);
+        sample.clear();
+        check(tree.distance_to(3) == 8 && tree.route_to<route_t>(4) == route_t{0, 2, 1, 3, 4} && !tree.reaches(5),
+              "shortest_path_tree");
+    }
+
+    {
+        Graph<int, int, double> sample;
+        fill_sample(sample);
+        check(delta_stepping(sample, 0, 2).distance_to(4) == 11, "delta_stepping");
+        check(delta_stepping(sample, 0, 2, 1e-12).distance_to(4) == 11, "delta_stepping: tiny delta");
+    }
+
+    {
+        Graph<int, int, double> sample;
+        fill_sample(sample);
+        auto hops = bfs(sample, 0, 2);
+        check(hops.distance_to(4) == 3 && hops.distance_to(1) == 1 && !hops.reaches(5), "bfs");
+    }
+
+    {
+        Graph<int, int, double> sample;
+        fill_sample(sample);
+        auto batch = dijkstra_batch<double, route_t>(sample, vector<pair<int, int>>{{0, 3}, {0, 5}, {0, 9}}, 2);
+        check(batch[0].distance == 8 && batch[1].status == query_status::no_route &&
+              batch[2].status == query_status::no_node, "dijkstra_batch");
+    }
+
+    {
+        Graph<int, int, double> sample;
+        fill_sample(sample);
+        ShortestPathCache<Graph<int, int, double>, route_t> cache(sample, 4);
+        cache.query(0, 4);
+        sample[0];
+        sample.at(1);
+        check(cache.query(0, 4).first == 11 && cache.hits() == 1, "path cache survives lookups");
+        sample.insert_or_assign_edge({0, 1}, 0.5);
+        check(cache.query(0, 4).first == 8.5, "path cache sees edge changes");
+    }
+
+    {
+        // после каждого изменения пути должны совпадать с деревом, посчитанным с нуля
+        Graph<int, int, double> sample;
+        fill_sample(sample);
+        DynamicShortestPaths<int, int, double> dynamic(sample, 0);
+
+        auto fresh = [&] {
+            auto tree = shortest_path_tree(sample, 0);
+            for (const auto& [key, node] : sample) {
+                if (dynamic.reaches(key) != tree.reaches(key) ||
+                    (tree.reaches(key) && dynamic.distance_to(key) != tree.distance_to(key))) {
+                    return false;
+                }
+            }
+            return true;
+        };
+
+        check(fresh(), "dynamic paths: initial");
+        sample.insert_or_assign_edge({2, 1}, 9);
+        check(fresh() && dynamic.distance_to(4) == 12, "dynamic paths: weight increase");
+        sample.insert_or_assign_edge({2, 3}, 1);
+        check(fresh() && dynamic.distance_to(4) == 5, "dynamic paths: weight decrease");
+        sample.insert_edge({4, 5}, 1);
+        sample.insert_edge({0, 5}, 7);
+        check(fresh() && dynamic.distance_to(5) == 6, "dynamic paths: edge insertion");
+        check(sample[3].erase_edge(4) && fresh() && dynamic.distance_to(5) == 7 && !dynamic.reaches(4),
+              "dynamic paths: edge erasure");
+        check(sample.erase_node(2) && fresh() && dynamic.distance_to(3) == 9, "dynamic paths: node erasure");
+    }
+
+    {
+        Graph<std::string, Point, double> named;
+        named["b"];
+        named["a"];
+        named.insert_edge({"b", "a"}, 1.5);
+        write_graph_file(named, "graph_check.bin");
+        {
+            MappedGraph<std::string_view, Point, double> mapped("graph_check.bin");
+            DijkstraEngine<decltype(mapped)> engine(mapped);
+            check(mapped.key(0) == "a" && engine.query<vector<std::string_view>>("b", "a").first == 1.5,
+                  "graph file with string keys");
+        }
+
+        Graph<int, int, double> sample;
+        fill_sample(sample);
+        write_graph_file(sample, "graph_check.bin");
+        {
+            MappedGraph<int, int, double> mapped("graph_check.bin");
+            DijkstraEngine<decltype(mapped)> engine(mapped);
+            check(engine.query<route_t>(0, 4).first == 11 && mapped.load().targets() == sample.freeze().targets(),
+                  "graph file with int keys");
+            check(throws([] { MappedGraph<std::string_view, int, double>("graph_check.bin"); },
+                         "graph file types do not match.\n"), "graph file: key type mismatch");
+        }
+        std::remove("graph_check.bin");
+    }
+
+    {
+        // комментарии, пустые строки, '+', CRLF, вес по умолчанию, нет перевода строки в конце
+        std::ofstream("edges_check.txt", std::ios::binary) << "# comment\n\n1 2 2.5\r\n+3\t4\n% other\n 5 6 -1.5";
+        auto edges = read_edge_list<int, double>("edges_check.txt", 2);
+        check(edges == vector<tuple<int, int, double>>{{1, 2, 2.5}, {3, 4, 1}, {5, 6, -1.5}}, "read_edge_list");
+
+        Graph<int, int, double> loaded;
+        check(load_edge_list(loaded, "edges_check.txt") == 3 && loaded.size() == 6 && loaded.at(3).edges.at(4) == 1,
+              "load_edge_list");
+
+        std::ofstream("edges_check.txt", std::ios::binary) << "a b 2\nb c\n";
+        auto named = read_edge_list<std::string, int>("edges_check.txt");
+        check(named.size() == 2 && get<0>(named[1]) == "b" && get<2>(named[1]) == 1, "read_edge_list: string keys");
+
+        // после второго ключа должен идти пробел или конец строки: "1 2.5" - ошибка, а не ребро (1, 2, 0.5)
+        for (std::string line : {"1 2.5", "1 2 x", "1", "1 2 3 4"}) {
+            std::ofstream("edges_check.txt", std::ios::binary) << "1 2\n" << line << "\n";
+            check(throws([] { read_edge_list<int, double>("edges_check.txt"); }, "bad edge list line 2.\n"),
+                  "read_edge_list: malformed line \"" + line + "\"");
+        }
+        std::remove("edges_check.txt");
+    }
+
+    {
+        VersionedGraph<int, int, double> versioned(Graph<int, int, double>{});
+        auto empty = versioned.snapshot();
+        versioned.update([](auto& graph) { graph.insert_node(1, 0); graph.insert_node(2, 0); });
+        versioned.update([](auto& graph) { graph.insert_edge({1, 2}, 2.5); });
+        check(versioned.version() == 2 && versioned.dijkstra<route_t>(1, 2).first == 2.5 && empty->empty(),
+              "versioned graph");
+        versioned.update([](auto& graph) { graph.insert_or_assign_edge({1, 2}, 1.0); }, false);
+        check(versioned.dijkstra<route_t>(1, 2).first == 2.5, "versioned graph: unpublished change");
+        versioned.publish();
+        check(versioned.version() == 3 && versioned.dijkstra<route_t>(1, 2).first == 1, "versioned graph: publish");
+    }
+
+    {
+        Graph<int, int, double> sample;
+        fill_sample(sample);
+        ShardedGraph<int, int, double> sharded;
+        for (const auto& [key, node] : sample) {
+            sharded.insert_node(key, node.value());
+        }
+        for (const auto& [key, node] : sample) {
+            for (const auto& [to, weight] : node) {
+                sharded.insert_edge({key, to}, weight);
+            }
+        }
+        check(sharded.size() == 6 && sharded.edge_count() == 6 &&
+              sharded.to_graph(2).freeze().targets() == sample.freeze().targets(), "sharded graph");
+    }
+
+    {
+        // pmr-граф: параллельная загрузка должна совпасть с однопоточной
+        vector<pair<int, int>> ring_nodes;
+        vector<tuple<int, int, double>> ring_edges;
+        for (int key = 0; key < 3000; key++) {
+            ring_nodes.emplace_back(key, key);
+            ring_edges.emplace_back(key, (key + 1) % 3000, 1);
+            ring_edges.emplace_back(key, (key * 7) % 3000, 2);
+            ring_edges.emplace_back(key, (key * 13) % 3000, 3);
+        }
+        ArenaGraph<int, int, double> arena;
+        Graph<int, int, double, pmr_storage> serial;
+        size_t parallel_count = arena.graph().bulk_insert(ring_nodes, ring_edges, edge_conflict::keep_first, 4);
+        size_t serial_count = serial.bulk_insert(ring_nodes, ring_edges, edge_conflict::keep_first, 1);
+        check(parallel_count == serial_count && arena.graph().freeze().targets() == serial.freeze().targets(),
+              "pmr bulk_insert: serial and parallel");
+        arena.release();
+        check(arena.graph().empty() && arena.graph().insert_node(1, 1).second, "arena graph: release");
+    }
+
+    {
+        Graph<int, int, double> sample;
+        fill_sample(sample);
+        size_t generation = sample.generation();
+        check(sample.erase_edges_if([](int, int, double weight) { return weight > 100; }) == 0 &&
+              sample.erase_edges_go_to_any(vector<int>{5}) == 0 && sample.generation() == generation,
+              "batched erase: no-op keeps generation");
+        check(sample.erase_edges_if([](int, int, double weight) { return weight >= 5; }) == 2 &&
+              sample.generation() != generation && !sample.at(1).edges.count(3) && sample.degree_out(2) == 1,
+              "erase_edges_if");
+        check(sample.erase_edges_go_to_any(vector<int>{1, 4}) == 3 && sample.degree_in(1) == 0 && sample.degree_in(4) == 0,
+              "erase_edges_go_to_any");
+        check(sample.erase_nodes(vector<int>{4, 5}) == 2 && sample.size() == 4 && !sample.contains(4), "erase_nodes");
+    }
+
+    {
+        Graph<int, int, double> sample;
+        fill_sample(sample);
+        sample.insert_edge({4, 2}, 1);
+        auto strong = strongly_connected_components(sample);
+        check(strong.count() == 3 && strong.connected(1, 4) && !strong.connected(0, 1), "strongly_connected_components");
+        auto weak = weakly_connected_components(sample);
+        check(weak.count() == 2 && weak.connected(0, 4) && !weak.connected(0, 5), "weakly_connected_components");
+    }
+
+    {
+        Graph<int, int, double> sample;
+        fill_sample(sample);
+        check(topological_sort(sample) == vector<int>{0, 5, 2, 1, 3, 4}, "topological_sort");
+        check(critical_path<double, route_t>(sample).first == 12, "critical_path");
+        check(dag_path<double, route_t>(sample, 0, 3, dag_objective::longest).first == 9, "dag_path longest");
+        sample.insert_edge({4, 2}, 1);
+        check(throws([&] { topological_sort(sample); }, "graph has a cycle.\n"), "topological_sort: cycle");
+    }
+
+    {
+        Graph<int, int, double> sample;
+        fill_sample(sample);
+        sample.insert_edge({3, 5}, -2);
+        check(bellman_ford<double, route_t>(sample, 0, 5) == pair<double, route_t>(6, {0, 2, 1, 3, 5}), "bellman_ford");
+        auto johnson = johnson_batch<double, route_t>(sample, vector<pair<int, int>>{{0, 5}, {1, 5}}, 2);
+        check(johnson[0].distance == 6 && johnson[1].distance == 3, "johnson_batch");
+        check(johnson_all_pairs(sample, 2)[2].distance_to(5) == 5, "johnson_all_pairs");
+        sample.insert_edge({4, 2}, -20);
+        check(throws([&] { bellman_ford<double, route_t>(sample, 0, 4); }, "negative cycle.\n"),
+              "bellman_ford: negative cycle");
+        check(!negative_cycle<route_t>(sample).empty(), "negative_cycle");
+    }
+
+    return failures == 0 ? 0 : 1;
 }